@@ -0,0 +1,349 @@
+// GABenchmark.cpp
+//
+// Micro and macro benchmarks of the genetic algorithm operators.
+//
+// The operators on one melody (fitness, key fitness, mutate, crossover, generateNotes, MIDI
+// encoding, the harmony of two tracks) are swept over the melody length, a whole generation
+// (crossover, mutation, scoring and selection of a population), a steady-state step, selection,
+// a multi-objective (NSGA-II) generation and its non-dominated sort, and MIDI encoding of the
+// population over the population size. Every result reports the time
+// per operation, the heap allocations per operation and the operations per second (generations
+// per second for whole generations), one line per result, as CSV or JSON lines.
+//
+//   benchmarkGA [--json] [--quick] [--min-time SECONDS] [--max-length N] [--max-population N]
+//               [--length N] [--threads N]
+
+#include "../StaticLibTestApp/GeneticAlgorithm.h"
+#include "../StaticLibTestApp/BatchFitness.h"
+#include "../StaticLibTestApp/Harmony.h"
+#include "../StaticLibTestApp/MidiEncoder.h"
+#include "../StaticLibTestApp/MultiObjective.h"
+#include "../StaticLibTestApp/ThreadPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+/******************** Allocation counting ***************************/
+// Every heap allocation of the program goes through these, so the benchmarks
+// can tell how many allocations (and bytes) an operation costs.
+static std::atomic<unsigned long long> allocation_count(0);
+static std::atomic<unsigned long long> allocation_bytes(0);
+
+void* operator new(size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+	return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+/******************** End of Allocation counting ***************************/
+
+struct BenchmarkOptions {
+	bool json;
+	double min_time;			// seconds each benchmark runs for at least
+	int max_length;
+	int max_population;
+	int length;					// melody length of the whole generation benchmarks
+	unsigned int threads;		// 0: one per hardware thread
+
+	BenchmarkOptions() : json(false), min_time(0.2), max_length(100000), max_population(1000000),
+		length(12), threads(0) {}
+};
+
+struct BenchmarkResult {
+	unsigned long long iterations;
+	double ns_per_op;
+	double allocs_per_op;
+	double bytes_per_op;
+};
+
+// Keeps the compiler from optimizing the benchmarked work away
+static volatile long long sink;
+
+/**
+* Runs op(iteration) until at least min_time seconds have passed, in batches that double in size,
+* and returns the time and allocations per call. The first call is a warm-up and not counted.
+**/
+template <typename Operation>
+static BenchmarkResult measure(Operation op, double min_time) {
+	typedef std::chrono::steady_clock Clock;
+	unsigned long long iteration = 0;
+	op(iteration++);
+
+	BenchmarkResult result;
+	unsigned long long batch = 1;
+	unsigned long long iterations = 0;
+	double seconds = 0;
+	unsigned long long allocations = 0, bytes = 0;
+	for (;;) {
+		unsigned long long count_before = allocation_count.load(), bytes_before = allocation_bytes.load();
+		Clock::time_point start = Clock::now();
+		for (unsigned long long i = 0; i < batch; ++i)
+			op(iteration++);
+		seconds += std::chrono::duration<double>(Clock::now() - start).count();
+		allocations += allocation_count.load() - count_before;
+		bytes += allocation_bytes.load() - bytes_before;
+		iterations += batch;
+		if (seconds >= min_time)
+			break;
+		batch *= 2;
+	}
+	result.iterations = iterations;
+	result.ns_per_op = seconds * 1e9 / iterations;
+	result.allocs_per_op = allocations / (double)iterations;
+	result.bytes_per_op = bytes / (double)iterations;
+	return result;
+}
+
+static void printHeader(const BenchmarkOptions& options) {
+	if (!options.json)
+		printf("benchmark,length,population,threads,iterations,ns_per_op,allocs_per_op,bytes_per_op,ops_per_sec\n");
+}
+
+static void printResult(const BenchmarkOptions& options, const char* name, int length, int population,
+	unsigned int threads, const BenchmarkResult& result) {
+	double ops_per_sec = result.ns_per_op > 0 ? 1e9 / result.ns_per_op : 0;
+	if (options.json)
+		printf("{\"benchmark\":\"%s\",\"length\":%d,\"population\":%d,\"threads\":%u,\"iterations\":%llu,"
+			"\"ns_per_op\":%.2f,\"allocs_per_op\":%.3f,\"bytes_per_op\":%.1f,\"ops_per_sec\":%.2f}\n",
+			name, length, population, threads, result.iterations, result.ns_per_op, result.allocs_per_op,
+			result.bytes_per_op, ops_per_sec);
+	else
+		printf("%s,%d,%d,%u,%llu,%.2f,%.3f,%.1f,%.2f\n", name, length, population, threads, result.iterations,
+			result.ns_per_op, result.allocs_per_op, result.bytes_per_op, ops_per_sec);
+	fflush(stdout);
+}
+
+/**
+* The operators on a single melody, for one melody length.
+**/
+static void benchmarkOperators(const BenchmarkOptions& options, int length) {
+	RandomStream rng(1, length);
+	Melody melody = generateNotes(length, rng);
+	Melody other = generateNotes(length, rng);
+
+	printResult(options, "fitness", length, 1, 1, measure([&](unsigned long long) {
+		sink += fitnessScore(melody);
+	}, options.min_time));
+
+	// a key kernel, whose pair terms are folded into one table (see FitnessTerms.h)
+	const FitnessFunction key_fitness = keyFitnessFunction(Key(9, SCALE_MINOR));
+	printResult(options, "fitness_key", length, 1, 1, measure([&](unsigned long long) {
+		sink += key_fitness(&melody.notes[0], melody.size());
+	}, options.min_time));
+
+	// scores a melody that is already in the cache
+	fitness_cache.score(melody);
+	printResult(options, "fitness_cached", length, 1, 1, measure([&](unsigned long long) {
+		sink += fitness_cache.score(melody);
+	}, options.min_time));
+
+	printResult(options, "mutate", length, 1, 1, measure([&](unsigned long long) {
+		mutate(melody, rng);
+	}, options.min_time));
+
+	FitnessState state;
+	initFitnessState(state, melody);
+	printResult(options, "mutate_delta", length, 1, 1, measure([&](unsigned long long) {
+		mutate(melody, state, rng);
+		sink += state.score;
+	}, options.min_time));
+
+	// into preallocated children, as in a generation
+	Melody child1(length), child2(length);
+	static const char* const crossover_names[] = { "crossover", "crossover_two_point", "crossover_uniform" };
+	for (int method = CROSSOVER_ONE_POINT; method <= CROSSOVER_UNIFORM; ++method)
+		printResult(options, crossover_names[method], length, 1, 1, measure([&](unsigned long long) {
+			crossover(melody, other, child1, child2, rng, (CrossoverMethod)method);
+			sink += child1[0];
+		}, options.min_time));
+
+	// deriving the fitness states of the children from those of the parents, as in a generation
+	FitnessState other_state, child_state1, child_state2;
+	initFitnessState(other_state, other);
+	printResult(options, "crossover_delta", length, 1, 1, measure([&](unsigned long long) {
+		crossover(melody, state, other, other_state, child1, child_state1, child2, &child_state2, rng);
+		sink += child_state1.score;
+	}, options.min_time));
+
+	printResult(options, "generateNotes", length, 1, 1, measure([&](unsigned long long) {
+		sink += generateNotes(length, rng)[0];
+	}, options.min_time));
+
+	// into a reused buffer, as when exporting many melodies
+	MidiOptions midi;
+	std::vector<unsigned char> smf;
+	printResult(options, "midi_encode", length, 1, 1, measure([&](unsigned long long) {
+		encodeMidiFile(melody, midi, smf);
+		sink += smf.size();
+	}, options.min_time));
+
+	// the vertical intervals of two voices, as scored for every child of a multi-track run
+	printResult(options, harmonyUsesAVX2() ? "harmony_avx2" : "harmony", length, 1, 1, measure([&](unsigned long long) {
+		sink += harmonyScore(&other.notes[0], &melody.notes[0], length);
+	}, options.min_time));
+}
+
+/**
+* Whole generations and the batch fitness kernel, for one population size.
+**/
+static void benchmarkGeneration(const BenchmarkOptions& options, ThreadPool& pool, int population_size) {
+	const unsigned long long seed = 1;
+	Population population;
+	initPopulation(population, population_size, options.length, seed, &pool);
+	unsigned long long generation = 0;
+	RandomStream rng(seed, population_size);
+
+	// the melodies of a new population are new to the cache; clear it so that big
+	// populations do not measure a cache that is full of earlier sizes
+	fitness_cache.clear();
+	printResult(options, "generation", options.length, population_size, pool.size(), measure([&](unsigned long long) {
+		evolveGeneration(population, seed, ++generation, &pool);
+		sink += population.parent1_score;
+	}, options.min_time));
+
+	if (population_size <= 100000) {
+		Population serial;
+		initPopulation(serial, population_size, options.length, seed, NULL);
+		generation = 0;
+		printResult(options, "generation_serial", options.length, population_size, 1, measure([&](unsigned long long) {
+			evolveGeneration(serial, seed, ++generation, NULL);
+			sink += serial.parent1_score;
+		}, options.min_time));
+	}
+
+	// selecting from the scores of the whole population
+	std::vector<size_t> indices;
+	printResult(options, "select_top2", options.length, population_size, 1, measure([&](unsigned long long) {
+		selectTopK(population.scores, 2, indices);
+		sink += indices[0];
+	}, options.min_time));
+	RankSelection ranking;
+	printResult(options, "rank_selection", options.length, population_size, 1, measure([&](unsigned long long) {
+		ranking.rank(population.scores);
+		sink += ranking.select(rng);
+	}, options.min_time));
+
+	// steady state: the two worst individuals are replaced per step
+	Population steady;
+	initPopulation(steady, population_size, options.length, seed, NULL);
+	unsigned long long step = 0;
+	printResult(options, "steady_state_step", options.length, population_size, 1, measure([&](unsigned long long) {
+		steadyStateStep(steady, 2, seed, ++step);
+		sink += steady.parent1_score;
+	}, options.min_time));
+
+	// multi-objective: a whole NSGA-II generation, and sorting its parents and children into fronts
+	ParetoPopulation pareto;
+	initParetoPopulation(pareto, population_size, options.length, seed, &pool);
+	generation = 0;
+	printResult(options, "nsga_generation", options.length, population_size, pool.size(), measure([&](unsigned long long) {
+		evolveParetoGeneration(pareto, seed, ++generation, &pool);
+		sink += pareto.ranks[0];
+	}, options.min_time));
+	std::vector<int> ranks;
+	printResult(options, "nondominated_sort", options.length, 2 * population_size, 1, measure([&](unsigned long long) {
+		sink += pareto.sorter.sort(&pareto.objectives[0], 2 * pareto.size, OBJECTIVES, ranks);
+	}, options.min_time));
+
+	// the Standard MIDI File of every individual, one buffer reused for all of them
+	MidiOptions midi;
+	std::vector<unsigned char> smf;
+	printResult(options, "midi_encode_population", options.length, population_size, 1, measure([&](unsigned long long) {
+		for (size_t i = 0; i < population.individuals.size(); ++i) {
+			encodeMidiFile(population.individuals[i], midi, smf);
+			sink += smf.size();
+		}
+	}, options.min_time));
+
+	PopulationColumns columns;
+	toColumns(population.individuals, columns);
+	std::vector<int> scores(population_size);
+	printResult(options, batchFitnessUsesAVX2() ? "batch_fitness_avx2" : "batch_fitness", options.length,
+		population_size, 1, measure([&](unsigned long long) {
+		batchFitness(columns, 0, columns.count, &scores[0]);
+		sink += scores[0];
+	}, options.min_time));
+}
+
+static bool parseArguments(int argc, char* argv[], BenchmarkOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		const char* arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (!strcmp(arg, "--json"))
+			options.json = true;
+		else if (!strcmp(arg, "--quick")) {
+			options.min_time = 0.02;
+			options.max_length = 4096;
+			options.max_population = 10000;
+		}
+		else if (!strcmp(arg, "--min-time") && value) {
+			options.min_time = atof(value);
+			++i;
+		}
+		else if (!strcmp(arg, "--max-length") && value) {
+			options.max_length = atoi(value);
+			++i;
+		}
+		else if (!strcmp(arg, "--max-population") && value) {
+			options.max_population = atoi(value);
+			++i;
+		}
+		else if (!strcmp(arg, "--length") && value && atoi(value) > 1) {
+			options.length = atoi(value);
+			++i;
+		}
+		else if (!strcmp(arg, "--threads") && value) {
+			options.threads = (unsigned int)atoi(value);
+			++i;
+		}
+		else
+			return false;
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	BenchmarkOptions options;
+	if (!parseArguments(argc, argv, options)) {
+		fprintf(stderr, "usage: %s [--json] [--quick] [--min-time SECONDS] [--max-length N] [--max-population N]"
+			" [--length N] [--threads N]\n", argv[0]);
+		return 2;
+	}
+
+	printHeader(options);
+
+	// melody lengths 8, 64, 512, ... up to the maximum, which is always included
+	std::vector<int> lengths;
+	for (long long length = 8; length < options.max_length; length *= 8)
+		lengths.push_back((int)length);
+	if (options.max_length > 1)
+		lengths.push_back(options.max_length);
+	for (size_t i = 0; i < lengths.size(); ++i)
+		benchmarkOperators(options, lengths[i]);
+
+	ThreadPool pool(options.threads);
+	for (int population = 10; population <= options.max_population; population *= 10)
+		benchmarkGeneration(options, pool, population);
+	return 0;
+}
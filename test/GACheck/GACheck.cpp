@@ -0,0 +1,566 @@
+// GACheck.cpp
+//
+// Consistency checks of the genetic algorithm, run by ctest.
+//
+// The fitness of a melody can be computed along several paths: the key kernel behind the
+// fitness cache, the delta re-scoring of FitnessState (also across crossover) and the batch
+// kernel over column-wise populations. They must agree exactly, in every key, also after any number of mutations and
+// in the populations the GA evolves. Each check prints the cases that fail, and the program
+// exits with 1 if any did.
+//
+//   checkGA
+
+#include "../StaticLibTestApp/GeneticAlgorithm.h"
+#include "../StaticLibTestApp/BatchFitness.h"
+#include "../StaticLibTestApp/Checkpoint.h"
+#include "../StaticLibTestApp/Harmony.h"
+#include "../StaticLibTestApp/IslandModel.h"
+#include "../StaticLibTestApp/MidiEncoder.h"
+#include "../StaticLibTestApp/Pareto.h"
+#include "../StaticLibTestApp/ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+/**
+* Counts and reports a failed check.
+**/
+static void fail(const std::string& what, const Melody& melody, int expected, int actual) {
+	if (failures++ < 20)
+		fprintf(stderr, "%s in %s: %d instead of %d for %s\n", what.c_str(), keyName(melody_key).c_str(), actual,
+			expected, toMusicString(melody).c_str());
+}
+
+/**
+* Counts and reports a failed check that is not about a melody.
+**/
+static void fail(const std::string& what, int expected, int actual) {
+	if (failures++ < 20)
+		fprintf(stderr, "%s: %d instead of %d\n", what.c_str(), actual, expected);
+}
+
+/**
+* A melody of any pitch classes, octaves 3 - 7 and durations, not only the notes of the scale.
+**/
+static Melody randomMelody(int length, RandomStream& rng) {
+	Melody melody(length);
+	for (int i = 0; i < length; ++i)
+		melody[i] = makeNote(rng.below(PITCH_CLASSES), 3 + rng.below(5), rng.below(DURATIONS));
+	return melody;
+}
+
+// The keys the checks run in
+static const char* const key_names[] = { "C major", "A minor", "F# major", "Bb minor", "MELA_65", "MELA_15" };
+
+/**
+* The fitness cache, the delta re-scoring state and the batch kernels (AVX2 and scalar) agree.
+**/
+static void checkFitnessPaths() {
+	RandomStream rng(1, 0);
+	for (size_t k = 0; k < sizeof(key_names) / sizeof(key_names[0]); ++k) {
+		Key key;
+		parseKey(key_names[k], key);
+		setMelodyKey(key);
+		for (int length = 1; length <= 40; length += 3) {
+			std::vector<Melody> melodies;
+			for (int i = 0; i < 37; ++i)
+				melodies.push_back(randomMelody(length, rng));
+			// in the scale, where most of the evolved melodies are
+			for (int i = 0; i < 37; ++i)
+				melodies.push_back(generateNotes(length, rng));
+
+			PopulationColumns columns;
+			toColumns(melodies, columns);
+			std::vector<int> batch(melodies.size()), scalar(melodies.size());
+			batchFitness(columns, 0, columns.count, &batch[0]);
+			batchFitnessScalar(columns, 0, columns.count, &scalar[0]);
+
+			for (size_t i = 0; i < melodies.size(); ++i) {
+				const int expected = fitness_cache.score(melodies[i]);
+				FitnessState state;
+				initFitnessState(state, melodies[i]);
+				if (state.score != expected)
+					fail("initFitnessState", melodies[i], expected, state.score);
+				if (batch[i] != expected)
+					fail("batchFitness", melodies[i], expected, batch[i]);
+				if (scalar[i] != expected)
+					fail("batchFitnessScalar", melodies[i], expected, scalar[i]);
+			}
+		}
+	}
+	setMelodyKey(Key());
+}
+
+/**
+* Delta re-scoring after point mutations matches a full score of the mutated melody.
+**/
+static void checkDeltaRescoring() {
+	RandomStream rng(2, 0);
+	for (size_t k = 0; k < sizeof(key_names) / sizeof(key_names[0]); ++k) {
+		Key key;
+		parseKey(key_names[k], key);
+		setMelodyKey(key);
+		for (int length = 1; length <= 33; length += 4) {
+			Melody melody = randomMelody(length, rng);
+			FitnessState state;
+			initFitnessState(state, melody);
+			for (int step = 0; step < 200; ++step) {
+				const size_t position = rng.below(length);
+				const Note note = makeNote(rng.below(PITCH_CLASSES), 3 + rng.below(5), rng.below(DURATIONS));
+				Melody mutated = melody;
+				mutated[position] = note;
+				const int expected = fitness_cache.score(mutated);
+				const int rescored = rescoreNoteChange(state, melody, position, note);
+				if (rescored != expected)
+					fail("rescoreNoteChange", mutated, expected, rescored);
+
+				// every other step through the GA's mutation operator
+				if (step % 2)
+					mutate(melody, state, rng);
+				else
+					applyNoteChange(state, melody, position, note);
+				if (state.score != fitness_cache.score(melody))
+					fail("applyNoteChange", melody, fitness_cache.score(melody), state.score);
+			}
+		}
+	}
+	setMelodyKey(Key());
+}
+
+/**
+* Populations large enough for the batch kernel score their individuals as the cache does,
+* with and without a thread pool, over a few generations.
+**/
+static void checkPopulationScores() {
+	Key key;
+	parseKey("Bb minor", key);
+	setMelodyKey(key);
+	ThreadPool pool(4);
+	for (int threaded = 0; threaded < 2; ++threaded) {
+		Population population;
+		initPopulation(population, (int)BATCH_FITNESS_POPULATION, 24, 3, threaded ? &pool : NULL);
+		for (unsigned long long generation = 1; generation <= 4; ++generation) {
+			for (size_t i = 0; i < population.individuals.size(); ++i) {
+				const int expected = fitness_cache.score(population.individuals[i]);
+				if (population.scores[i] != expected)
+					fail("evaluate", population.individuals[i], expected, population.scores[i]);
+			}
+			evolveGeneration(population, 3, generation, threaded ? &pool : NULL);
+		}
+	}
+	setMelodyKey(Key());
+}
+
+/**
+* Smaller populations score their children from the fitness states of their parents, which
+* must score as the cache does with every crossover method, for generations (with and without
+* a thread pool) and steady-state steps, also after migrants replace individuals.
+**/
+static void checkDeltaPopulations() {
+	Key key;
+	parseKey("MELA_15", key);
+	setMelodyKey(key);
+	ThreadPool pool(4);
+	RandomStream rng(7, 0);
+	const int lengths[] = { 1, 2, 17 };
+	int accepted = 0;
+	for (int l = 0; l < 3; ++l) {
+		for (int method = CROSSOVER_ONE_POINT; method <= CROSSOVER_UNIFORM; ++method) {
+			for (int run = 0; run < 3; ++run) {
+				// a generational run on the calling thread, one on the pool and a steady-state run
+				ThreadPool* run_pool = run == 1 ? &pool : NULL;
+				const std::string what = std::string(run == 2 ? "steady-state step" : "generation") + " of "
+					+ std::to_string(lengths[l]) + " notes, crossover " + std::to_string(method);
+				Population population;
+				population.crossover = (CrossoverMethod)method;
+				population.selection.method = method == CROSSOVER_TWO_POINT ? SELECTION_TOURNAMENT : SELECTION_BEST_TWO;
+				initPopulation(population, 40, lengths[l], 8, run_pool);
+				for (unsigned long long generation = 1; generation <= 30; ++generation) {
+					if (run == 2)
+						steadyStateStep(population, 5, 8, generation);
+					else
+						evolveGeneration(population, 8, generation, run_pool);
+					for (size_t i = 0; i < population.individuals.size(); ++i) {
+						const int expected = fitness_cache.score(population.individuals[i]);
+						if (population.scores[i] != expected)
+							fail(what, population.individuals[i], expected, population.scores[i]);
+					}
+					if (generation % 5 == 0) {
+						Melody migrant = population.parent1();
+						mutate(migrant, rng);
+						accepted += acceptMigrant(population, migrant, fitness_cache.score(migrant));
+					}
+				}
+			}
+		}
+	}
+	if (accepted == 0)
+		fail("migrants accepted by the populations", Melody(), 1, 0);
+	setMelodyKey(Key());
+}
+
+/**
+* The harmony kernel (AVX2 when built with it) sums the vertical scores of the notes, at lengths
+* around the 32 notes of a vector step and from unaligned notes.
+**/
+static void checkHarmonyScores() {
+	RandomStream rng(5, 0);
+	for (int length = 0; length <= 100; ++length) {
+		for (int offset = 0; offset < 3; ++offset) {
+			const Melody lower = randomMelody(length + offset, rng), upper = randomMelody(length + offset, rng);
+			int expected = 0;
+			for (int i = offset; i < length + offset; ++i)
+				expected += verticalScore(lower[i], upper[i]);
+			const int actual = length ? harmonyScore(&lower.notes[offset], &upper.notes[offset], length) : 0;
+			if (actual != expected)
+				fail("harmonyScore of " + std::to_string(length) + " notes from " + std::to_string(offset), lower,
+					expected, actual);
+		}
+	}
+}
+
+/**
+* The timed harmony of two tracks scores each pair of notes that sound together once, as
+* found by laying both tracks out on a grid of the shortest duration, also when the tracks share
+* the rhythm of their first notes (which go to the kernel).
+**/
+static void checkTimedHarmony() {
+	RandomStream rng(6, 0);
+	std::vector<size_t> lower_steps, upper_steps;	// the note sounding at each step of the grid
+	for (int c = 0; c < 400; ++c) {
+		Melody lower = randomMelody(1 + rng.below(60), rng), upper = randomMelody(1 + rng.below(60), rng);
+		const size_t same_rhythm = rng.below((unsigned int)std::min(lower.size(), upper.size()) + 1);
+		for (size_t i = 0; i < same_rhythm; ++i)
+			upper[i] = makeNote(notePitchClass(upper[i]), noteOctave(upper[i]), noteDuration(lower[i]));
+
+		lower_steps.clear();
+		upper_steps.clear();
+		for (size_t i = 0; i < lower.size(); ++i)
+			lower_steps.insert(lower_steps.end(), noteLength(lower[i]), i);
+		for (size_t i = 0; i < upper.size(); ++i)
+			upper_steps.insert(upper_steps.end(), noteLength(upper[i]), i);
+		int expected = 0;
+		for (size_t t = 0; t < std::min(lower_steps.size(), upper_steps.size()); ++t)
+			if (t == 0 || lower_steps[t] != lower_steps[t - 1] || upper_steps[t] != upper_steps[t - 1])
+				expected += verticalScore(lower[lower_steps[t]], upper[upper_steps[t]]);
+
+		const int actual = timedHarmonyScore(&lower.notes[0], lower.size(), &upper.notes[0], upper.size());
+		if (actual != expected)
+			fail("timedHarmonyScore with " + std::to_string(same_rhythm) + " notes in the same rhythm", lower,
+				expected, actual);
+	}
+}
+
+/**
+* The MIDI file header and the note lengths agree on the time division, also for divisions a
+* header cannot hold.
+**/
+static void checkMidiTimeDivision() {
+	static const unsigned int divisions[] = { 0, 1, 96, 480, MAX_TICKS_PER_QUARTER, 0x8000, 0xFFFFFFFFu };
+	Melody melody;
+	for (int duration = 0; duration < DURATIONS; ++duration)
+		melody.notes.push_back(makeNote(duration % PITCH_CLASSES, DEFAULT_OCTAVE, duration));
+	std::vector<unsigned char> bytes;
+	std::vector<MidiEvent> events;
+	for (size_t d = 0; d < sizeof(divisions) / sizeof(divisions[0]); ++d) {
+		MidiOptions options;
+		options.ticks_per_quarter = divisions[d];
+		encodeMidiFile(melody, options, bytes);
+		encodeMidiEvents(melody, options, events);
+		const unsigned int header = bytes[12] << 8 | bytes[13];
+		// the first note off follows the header (14 bytes), the track header (8), the tempo (7),
+		// the program change (3) and the first note on (4)
+		unsigned int delta = 0;
+		for (size_t i = 36; i < bytes.size(); ++i) {
+			delta = delta << 7 | (bytes[i] & 0x7F);
+			if (!(bytes[i] & 0x80))
+				break;
+		}
+		const int expected = (int)(header * noteLength(melody[0]) / QUARTER_NOTE_LENGTH);
+		if (header < 1 || header > MAX_TICKS_PER_QUARTER)
+			fail("MIDI header division", melody, (int)ticksPerQuarter(options), (int)header);
+		if ((int)delta != expected)
+			fail("MIDI file note length", melody, expected, (int)delta);
+		if ((int)events[1].delta != expected)
+			fail("encodeMidiEvents note length", melody, expected, (int)events[1].delta);
+	}
+}
+
+/**
+* A checkpoint with a key, notes or selection settings out of range (but a valid checksum) is
+* rejected as corrupt.
+**/
+static void checkCheckpointValidation() {
+	const std::string path = "checkGA_checkpoint.tmp";
+	RandomStream rng(4, 0);
+	Population population;
+	initPopulation(population, 8, 6, 4, NULL);
+	const Note bad_notes[] = { makeNote(PITCH_CLASSES), makeNote(0, MAX_OCTAVE + 1), (Note)(makeNote(0) | 0x800) };
+	const Key bad_keys[] = { Key(PITCH_CLASSES, SCALE_MAJOR), Key(-1, SCALE_MINOR), Key(0, SCALE_MELAKARTA, 0),
+		Key(0, SCALE_MELAKARTA, MELAKARTA_COUNT + 1) };
+	const double bad_truncations[] = { 0, -0.5, 1.5, std::numeric_limits<double>::quiet_NaN() };
+	const size_t note_cases = sizeof(bad_notes) / sizeof(bad_notes[0]);
+	const size_t key_cases = sizeof(bad_keys) / sizeof(bad_keys[0]);
+	const size_t truncation_cases = sizeof(bad_truncations) / sizeof(bad_truncations[0]);
+	std::vector<unsigned char> image;
+	// the last case is a tournament size of 0
+	for (size_t c = 0; c <= note_cases + key_cases + truncation_cases; ++c) {
+		Population saved = population;
+		CheckpointState state;
+		std::string what;
+		if (c < note_cases) {
+			saved.individuals[rng.below(8)][rng.below(6)] = bad_notes[c];
+			what = "note";
+		}
+		else if (c < note_cases + key_cases) {
+			state.key = bad_keys[c - note_cases];
+			what = "key";
+		}
+		else if (c < note_cases + key_cases + truncation_cases) {
+			saved.selection.truncation = bad_truncations[c - note_cases - key_cases];
+			what = "truncation";
+		}
+		else {
+			saved.selection.tournament_size = 0;
+			what = "tournament size";
+		}
+		makeCheckpoint(saved, state, image);
+		Population loaded;
+		CheckpointState loaded_state;
+		std::string error;
+		if (!writeCheckpoint(path, image) || loadCheckpoint(path, loaded, loaded_state, error)
+			|| error.find("corrupt") == std::string::npos)
+			fail("loadCheckpoint of a bad " + what + " (" + error + ")", saved.parent1(), 0, 1);
+	}
+	remove(path.c_str());
+	setMelodyKey(Key());
+}
+
+/**
+* Runs generation (or steady-state step) generation of a run, as the programs do.
+**/
+static void evolveRun(Population& population, int steady_state, unsigned long long seed, unsigned long long generation) {
+	if (steady_state > 0)
+		steadyStateStep(population, steady_state, seed, generation);
+	else
+		evolveGeneration(population, seed, generation, NULL);
+}
+
+/**
+* A run resumed from a checkpoint continues exactly as the run that saved it, for generations
+* and for steady-state steps, with the selection and crossover of the checkpoint.
+**/
+static void checkCheckpointResume() {
+	const std::string path = "checkGA_checkpoint.tmp";
+	const unsigned long long seed = 11;
+	const unsigned long long saved_at = 5, generations = 12;
+	Key key;
+	parseKey("F# major", key);
+	for (int steady_state = 0; steady_state <= 6; steady_state += 6) {
+		setMelodyKey(key);
+		Population population;
+		population.selection.method = steady_state ? SELECTION_TOURNAMENT : SELECTION_BEST_TWO;
+		population.crossover = steady_state ? CROSSOVER_UNIFORM : CROSSOVER_TWO_POINT;
+		initPopulation(population, 32, 16, seed, NULL);
+		std::vector<unsigned char> image;
+		for (unsigned long long generation = 1; generation <= generations; ++generation) {
+			evolveRun(population, steady_state, seed, generation);
+			if (generation == saved_at) {
+				CheckpointState state;
+				state.seed = seed;
+				state.generation = generation;
+				state.key = melody_key;
+				state.steady_state = steady_state;
+				makeCheckpoint(population, state, image);
+				if (!writeCheckpoint(path, image))
+					fail("writeCheckpoint", population.parent1(), 1, 0);
+			}
+		}
+
+		// resume in another key and with a cleared cache, which the checkpoint restores
+		setMelodyKey(Key());
+		Population resumed;
+		CheckpointState state;
+		std::string error;
+		if (!loadCheckpoint(path, resumed, state, error)) {
+			fail("loadCheckpoint (" + error + ")", population.parent1(), 1, 0);
+			continue;
+		}
+		for (unsigned long long generation = state.generation + 1; generation <= generations; ++generation)
+			evolveRun(resumed, state.steady_state, state.seed, generation);
+		const std::string what = steady_state ? "resumed steady-state run" : "resumed generational run";
+		for (size_t i = 0; i < population.individuals.size(); ++i) {
+			if (resumed.individuals[i] != population.individuals[i])
+				fail(what + " individual " + std::to_string(i), resumed.individuals[i], 1, 0);
+			if (resumed.scores[i] != population.scores[i])
+				fail(what + " score", population.individuals[i], population.scores[i], resumed.scores[i]);
+		}
+		if (resumed.parent1_index != population.parent1_index || resumed.parent2_index != population.parent2_index)
+			fail(what + " parents", population.parent1(), (int)population.parent1_index, (int)resumed.parent1_index);
+	}
+	remove(path.c_str());
+	setMelodyKey(Key());
+}
+
+/**
+* Fronts by the definition, in O(MN^2): the individuals no other one dominates are front 0,
+* and every other individual is one front behind the last of the ones dominating it.
+**/
+static void naiveRanks(const int* objectives, size_t count, int objective_count, std::vector<int>& ranks) {
+	std::vector<size_t> dominators(count, 0);
+	std::vector<std::vector<size_t> > dominated(count);
+	for (size_t a = 0; a < count; ++a)
+		for (size_t b = 0; b < count; ++b)
+			if (dominates(&objectives[a * objective_count], &objectives[b * objective_count], objective_count)) {
+				dominated[a].push_back(b);
+				++dominators[b];
+			}
+	std::vector<size_t> front;
+	for (size_t i = 0; i < count; ++i)
+		if (dominators[i] == 0)
+			front.push_back(i);
+	ranks.assign(count, -1);
+	for (int rank = 0; !front.empty(); ++rank) {
+		std::vector<size_t> next;
+		for (size_t k = 0; k < front.size(); ++k) {
+			ranks[front[k]] = rank;
+			for (size_t d = 0; d < dominated[front[k]].size(); ++d)
+				if (--dominators[dominated[front[k]][d]] == 0)
+					next.push_back(dominated[front[k]][d]);
+		}
+		front.swap(next);
+	}
+}
+
+/**
+* Crowding distance of one member by its definition: the distance between the members just
+* below and just above it in every objective (equal values ordered by index), infinite at an
+* extreme.
+**/
+static double naiveCrowding(const int* objectives, int objective_count, const size_t* members, size_t count,
+	size_t member) {
+	const double infinity = std::numeric_limits<double>::infinity();
+	if (count <= 2)
+		return infinity;
+	double distance = 0;
+	for (int j = 0; j < objective_count; ++j) {
+		const int value = objectives[member * objective_count + j];
+		int low = value, high = value;
+		bool has_below = false, has_above = false;
+		int below = 0, above = 0;
+		for (size_t k = 0; k < count; ++k) {
+			const size_t other = members[k];
+			const int v = objectives[other * objective_count + j];
+			low = std::min(low, v);
+			high = std::max(high, v);
+			if (v < value || (v == value && other < member)) {
+				if (!has_below || v > below)
+					below = v;
+				has_below = true;
+			}
+			else if (v > value || (v == value && other > member)) {
+				if (!has_above || v < above)
+					above = v;
+				has_above = true;
+			}
+		}
+		if (!has_below || !has_above)
+			return infinity;
+		if (high != low)
+			distance += (above - below) * (1.0 / (high - low));
+	}
+	return distance;
+}
+
+/**
+* The fast non-dominated sort ranks as the definition does, its fronts list the individuals of
+* each rank, and the crowding distance of every front is the one of the definition, over random
+* populations with many equal objective vectors.
+**/
+static void checkParetoRanking() {
+	RandomStream rng(12, 0);
+	ParetoSorter sorter;
+	std::vector<int> objectives, ranks, expected;
+	std::vector<double> distance;
+	std::vector<size_t> scratch;
+	for (int c = 0; c < 200; ++c) {
+		const size_t count = 1 + rng.below(80);
+		const int objective_count = 1 + (int)rng.below(4);
+		const unsigned int values = 2 + rng.below(c % 2 ? 5 : 1000);
+		objectives.resize(count * objective_count);
+		for (size_t i = 0; i < objectives.size(); ++i)
+			objectives[i] = (int)rng.below(values) - 2;
+		const std::string what = "Pareto case " + std::to_string(c);
+
+		const size_t fronts = sorter.sort(&objectives[0], count, objective_count, ranks);
+		naiveRanks(&objectives[0], count, objective_count, expected);
+		for (size_t i = 0; i < count; ++i)
+			if (ranks[i] != expected[i])
+				fail(what + " rank of " + std::to_string(i), expected[i], ranks[i]);
+		size_t listed = 0;
+		for (size_t f = 0; f < fronts; ++f) {
+			for (size_t k = 0; k < sorter.frontSize(f); ++k)
+				if (ranks[sorter.front(f)[k]] != (int)f)
+					fail(what + " member of front " + std::to_string(f), (int)f, ranks[sorter.front(f)[k]]);
+			listed += sorter.frontSize(f);
+
+			distance.assign(count, -1);
+			crowdingDistance(&objectives[0], objective_count, sorter.front(f), sorter.frontSize(f), distance, scratch);
+			for (size_t k = 0; k < sorter.frontSize(f); ++k) {
+				const size_t member = sorter.front(f)[k];
+				const double expected_distance = naiveCrowding(&objectives[0], objective_count, sorter.front(f),
+					sorter.frontSize(f), member);
+				if (distance[member] != expected_distance)
+					fail(what + " crowding distance (in thousandths) of " + std::to_string(member),
+						(int)std::min(expected_distance * 1000, 1e9), (int)std::min(distance[member] * 1000, 1e9));
+			}
+		}
+		if (listed != count)
+			fail(what + " individuals in the fronts", (int)count, (int)listed);
+	}
+}
+
+/**
+* Key names parse to their keys, and names with anything after the melakarta number do not.
+**/
+static void checkKeyNames() {
+	static const char* const good[] = { "C major", "a minor", "F#", "Bbm", "MELA_1", "mela_65", "MELA_72" };
+	static const char* const bad[] = { "MELA_0", "MELA_73", "MELA_65xyz", "MELA_7.5", "MELA_", "MELA_ 5", "MELA_+5",
+		"MELA_99999999999999999999", "H major", "C majestic" };
+	for (size_t i = 0; i < sizeof(good) / sizeof(good[0]); ++i) {
+		Key key;
+		if (!parseKey(good[i], key))
+			fail(std::string("parseKey rejected ") + good[i], Melody(), 1, 0);
+	}
+	for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+		Key key;
+		if (parseKey(bad[i], key))
+			fail(std::string("parseKey accepted ") + bad[i], Melody(), 0, 1);
+	}
+}
+
+int main()
+{
+	checkKeyNames();
+	checkFitnessPaths();
+	checkDeltaRescoring();
+	checkPopulationScores();
+	checkDeltaPopulations();
+	checkHarmonyScores();
+	checkTimedHarmony();
+	checkMidiTimeDivision();
+	checkCheckpointValidation();
+	checkCheckpointResume();
+	checkParetoRanking();
+	if (failures) {
+		fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+	printf("all checks passed\n");
+	return 0;
+}
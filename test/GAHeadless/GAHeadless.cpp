@@ -0,0 +1,37 @@
+// GAHeadless.cpp
+//
+// The GA music program without CFugue: always runs headless (see runHeadless()), so it builds and
+// runs on servers with no sound hardware or MIDI library. Takes the options of the interactive
+// program (see CommandLine.h) except the MIDI port and --audition.
+//
+//   headlessGA [options]
+
+#include "../StaticLibTestApp/HeadlessRun.h"
+
+#include <cstdio>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+	RunSetup run;
+	RunOptions& options = run.options;
+	bool help = false;
+	std::string error;
+	if (!parseCommandLine(argc, argv, options, help, error)) {
+		fprintf(stderr, "%s\n%s", error.c_str(), usage(argv[0]).c_str());
+		return 2;
+	}
+	if (help) {
+		printf("%s", usage(argv[0]).c_str());
+		return 0;
+	}
+	if (options.audition || options.port_given) {
+		fprintf(stderr, "%s has no MIDI output, it takes no port or --audition\n", argv[0]);
+		return 2;
+	}
+	options.headless = true;
+
+	if (!setUpRun(run))
+		return 1;
+	return runHeadless(run);
+}
@@ -0,0 +1,45 @@
+// Audition.cpp
+//
+// Plays the best melody of a run in the background while the generations keep running.
+
+#include "stdafx.h"
+#include "Audition.h"
+
+#include <climits>
+
+Audition::Audition(int port, int timer_resolution) : player(port, timer_resolution), playing_score(INT_MIN),
+	started(false) {}
+
+Audition::~Audition() {
+	stop();
+}
+
+void Audition::offer(const Melody& best, int score) {
+	if (score <= playing_score)
+		return;
+	playing_score = score;
+	play(best);
+}
+
+void Audition::finish(const Melody& last) {
+	if (!started || last != playing)
+		play(last);
+	while (player.IsPlaying()) // Wait while the play is in progress
+		CFugue::MidiTimer::Sleep(100);
+	stop();
+}
+
+void Audition::play(const Melody& melody) {
+	stop();
+	playing.notes.assign(melody.notes.begin(), melody.notes.end());
+	const std::string text = toMusicString(melody);
+	music.assign(text.begin(), text.end());	// music strings are plain ASCII
+	started = player.PlayAsync(music.c_str());
+}
+
+void Audition::stop() {
+	// Match every PlayAsync with a StopPlay, also when the melody has ended by itself
+	if (started)
+		player.StopPlay();
+	started = false;
+}
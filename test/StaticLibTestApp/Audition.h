@@ -0,0 +1,49 @@
+// Audition.h
+//
+// Plays the best melody of a run in the background while the generations keep running.
+//
+// offer() is called after every generation and only does something when the best score has
+// improved: the melody that is playing is stopped and the new best starts with
+// CFugue::Player::PlayAsync(), so the listener always hears the latest best without the GA
+// waiting for the melody to end.
+
+#pragma once
+
+#include <string>
+#include "CFugueLib.h" // found through the include directories of the build (CFugue's include folder)
+#include "Melody.h"
+
+class Audition {
+public:
+	Audition(int port, int timer_resolution);
+	~Audition();
+
+	/**
+	* Starts playing best (its score in tenths) if it beats the melody auditioned last,
+	* stopping that one wherever it is.
+	**/
+	void offer(const Melody& best, int score);
+
+	/**
+	* Lets last play to the end: the melody that is playing is kept if it is last, and
+	* replaced by it otherwise. Returns when it has ended.
+	**/
+	void finish(const Melody& last);
+
+private:
+	Audition(const Audition&);				// not copyable
+	Audition& operator=(const Audition&);
+
+	void play(const Melody& melody);
+	void stop();
+
+	CFugue::Player player;
+	Melody playing;				// the melody auditioned last
+	int playing_score;
+	bool started;				// PlayAsync() was called and still needs its StopPlay()
+#ifdef UNICODE
+	std::wstring music;			// music string of the melody, kept while it plays
+#else
+	std::string music;
+#endif
+};
@@ -0,0 +1,149 @@
+// BatchFitness.cpp
+//
+// Structure-of-arrays population storage and a batch fitness kernel that scores many
+// melodies at once.
+
+#include "BatchFitness.h"
+#include "Fitness.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+void PopulationColumns::resize(size_t individuals, size_t notes_per_individual) {
+	count = individuals;
+	length = notes_per_individual;
+	stride = (individuals + BATCH_LANES - 1) / BATCH_LANES * BATCH_LANES;
+	notes.assign(stride * length, makeNote(0));
+}
+
+void PopulationColumns::setMelody(size_t individual, const Melody& melody) {
+	for (size_t i = 0; i < length; ++i)
+		at(individual, i) = melody[i];
+}
+
+void PopulationColumns::getMelody(size_t individual, Melody& melody) const {
+	melody.notes.resize(length);
+	for (size_t i = 0; i < length; ++i)
+		melody[i] = at(individual, i);
+}
+
+void toColumns(const std::vector<Melody>& population, PopulationColumns& columns) {
+	columns.resize(population.size(), population.empty() ? 0 : population[0].size());
+	for (size_t j = 0; j < population.size(); ++j)
+		columns.setMelody(j, population[j]);
+}
+
+/**
+* Adds the endpoint and variety bonuses to one block of lanes and writes the valid lanes out.
+**/
+static void finishBlock(const PopulationColumns& columns, size_t base, size_t end,
+	const int* block_scores, const unsigned int* block_masks, int* scores) {
+	const Note* first = &columns.notes[base];
+	const Note* last = &columns.notes[(columns.length - 1) * columns.stride + base];
+	for (size_t lane = 0; lane < BATCH_LANES && base + lane < end; ++lane) {
+		scores[base + lane] = block_scores[lane]
+			+ endpointScore(first[lane], last[lane])
+			+ varietyScore(countPitchClasses(block_masks[lane]));
+	}
+}
+
+void batchFitnessScalar(const PopulationColumns& columns, size_t begin, size_t end, int* scores) {
+	const signed char* table = fitness_tables->pairs.scores;
+
+	for (size_t base = begin; base < end; base += BATCH_LANES) {
+		if (columns.length == 0) {
+			for (size_t j = base; j < end && j < base + BATCH_LANES; ++j)
+				scores[j] = 0;
+			continue;
+		}
+
+		int block_scores[BATCH_LANES] = { 0 };
+		unsigned int block_masks[BATCH_LANES] = { 0 };
+
+		for (size_t i = 0; i + 1 < columns.length; ++i) {
+			const Note* current = &columns.notes[i * columns.stride + base];
+			const Note* next = current + columns.stride;
+			for (size_t lane = 0; lane < BATCH_LANES; ++lane) {
+				block_scores[lane] += table[pairIndex(current[lane], next[lane])];
+				block_masks[lane] |= 1u << notePitchClass(current[lane]);
+			}
+		}
+		finishBlock(columns, base, end, block_scores, block_masks, scores);
+	}
+}
+
+#ifdef __AVX2__
+
+// Loads the 16-bit notes of 8 individuals at one position and widens them to 32 bit lanes
+static inline __m256i loadNotes(const Note* notes) {
+	return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(notes)));
+}
+
+static void batchFitnessAVX2(const PopulationColumns& columns, size_t begin, size_t end, int* scores) {
+	// the pair scores are bytes: every lane gathers the 4 bytes at its index and keeps the
+	// lowest, and the endpoint table after the pair table keeps the last gather in bounds
+	const int* table = reinterpret_cast<const int*>(fitness_tables->pairs.scores);
+	const __m256i low_nibble = _mm256_set1_epi32(0x0F);
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i min_delta = _mm256_set1_epi32(-2);
+	const __m256i max_delta = _mm256_set1_epi32(2);
+	const __m256i pitch_classes = _mm256_set1_epi32(PITCH_CLASSES);
+
+	for (size_t base = begin; base < end; base += BATCH_LANES) {
+		if (columns.length == 0) {
+			for (size_t j = base; j < end && j < base + BATCH_LANES; ++j)
+				scores[j] = 0;
+			continue;
+		}
+
+		__m256i score = _mm256_setzero_si256();
+		__m256i mask = _mm256_setzero_si256();
+
+		__m256i current = loadNotes(&columns.notes[base]);
+		__m256i current_pc = _mm256_and_si256(current, low_nibble);
+		__m256i current_octave = _mm256_and_si256(_mm256_srli_epi32(current, 4), low_nibble);
+
+		for (size_t i = 0; i + 1 < columns.length; ++i) {
+			__m256i next = loadNotes(&columns.notes[(i + 1) * columns.stride + base]);
+			__m256i next_pc = _mm256_and_si256(next, low_nibble);
+			__m256i next_octave = _mm256_and_si256(_mm256_srli_epi32(next, 4), low_nibble);
+
+			// pairIndex(): ((clamped octave difference + 2) * 12 + from) * 12 + to
+			__m256i delta = _mm256_min_epi32(_mm256_max_epi32(_mm256_sub_epi32(next_octave, current_octave), min_delta),
+				max_delta);
+			__m256i index = _mm256_mullo_epi32(_mm256_sub_epi32(delta, min_delta), pitch_classes);
+			index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(index, current_pc), pitch_classes), next_pc);
+			__m256i pair = _mm256_i32gather_epi32(table, index, 1);
+			score = _mm256_add_epi32(score, _mm256_srai_epi32(_mm256_slli_epi32(pair, 24), 24));
+			mask = _mm256_or_si256(mask, _mm256_sllv_epi32(one, current_pc));
+
+			current_pc = next_pc;
+			current_octave = next_octave;
+		}
+
+		int block_scores[BATCH_LANES];
+		unsigned int block_masks[BATCH_LANES];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(block_scores), score);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(block_masks), mask);
+		finishBlock(columns, base, end, block_scores, block_masks, scores);
+	}
+}
+
+#endif // __AVX2__
+
+void batchFitness(const PopulationColumns& columns, size_t begin, size_t end, int* scores) {
+#ifdef __AVX2__
+	batchFitnessAVX2(columns, begin, end, scores);
+#else
+	batchFitnessScalar(columns, begin, end, scores);
+#endif
+}
+
+bool batchFitnessUsesAVX2() {
+#ifdef __AVX2__
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,66 @@
+// BatchFitness.h
+//
+// Structure-of-arrays population storage and a batch fitness kernel that scores many
+// melodies at once.
+//
+// The population is stored column-wise: note i of every individual is contiguous, so the
+// kernel walks the melodies position by position and scores BATCH_LANES individuals with
+// every instruction. Pair scores come from the pair table of the fitness of the run (see
+// fitness_tables) instead of branches. When the target is built with AVX2 the kernel uses
+// 256-bit gathers; otherwise a scalar loop does the same integer arithmetic, so both paths give
+// bit-identical scores, which match fitness_cache.score() in the key of the run.
+
+#pragma once
+
+#include <vector>
+#include "Melody.h"
+
+// Individuals scored per SIMD step. Columns are padded to a multiple of this.
+const size_t BATCH_LANES = 8;
+
+/**
+* A population of equally long melodies, stored column-wise.
+**/
+struct PopulationColumns {
+	size_t count;				// individuals
+	size_t length;				// notes per individual
+	size_t stride;				// count rounded up to a multiple of BATCH_LANES
+	std::vector<Note> notes;	// notes[position * stride + individual]
+
+	PopulationColumns() : count(0), length(0), stride(0) {}
+
+	/**
+	* Resizes the storage, reusing the existing allocation when it is large enough.
+	**/
+	void resize(size_t individuals, size_t notes_per_individual);
+
+	Note& at(size_t individual, size_t position) { return notes[position * stride + individual]; }
+	Note at(size_t individual, size_t position) const { return notes[position * stride + individual]; }
+
+	/**
+	* Copies one melody into / out of the columns.
+	**/
+	void setMelody(size_t individual, const Melody& melody);
+	void getMelody(size_t individual, Melody& melody) const;
+};
+
+/**
+* Converts a population of equally long melodies to column-wise storage.
+**/
+void toColumns(const std::vector<Melody>& population, PopulationColumns& columns);
+
+/**
+* Scores (in tenths) the individuals [begin, end) of the columns into scores[begin, end).
+* begin must be a multiple of BATCH_LANES. Uses AVX2 when available.
+**/
+void batchFitness(const PopulationColumns& columns, size_t begin, size_t end, int* scores);
+
+/**
+* Portable version of batchFitness(), giving bit-identical results.
+**/
+void batchFitnessScalar(const PopulationColumns& columns, size_t begin, size_t end, int* scores);
+
+/**
+* True when batchFitness() was built with the AVX2 kernel.
+**/
+bool batchFitnessUsesAVX2();
@@ -0,0 +1,501 @@
+// Checkpoint.cpp
+//
+// Binary checkpoints of a single population GA run, to stop a long run and resume it later.
+
+#include "Checkpoint.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char CHECKPOINT_MAGIC[8] = { 'G', 'A', 'M', 'C', 'K', 'P', 'T', '\0' };
+static const unsigned int CHECKPOINT_VERSION = 3;	// 2: 16-bit notes with a duration, 3: convergence section
+// tells a checkpoint of a machine with another byte order apart
+static const unsigned long long BYTE_ORDER_MARK = 0x0102030405060708ULL;
+static const size_t SECTION_ALIGNMENT = 64;
+
+struct CheckpointHeader {
+	char magic[8];
+	unsigned long long byte_order;
+	unsigned int version;
+	unsigned int note_size;				// sizeof(Note) of the writer
+	unsigned long long seed;
+	unsigned long long generation;
+	int key_tonic;
+	int key_scale;
+	int key_mela;
+	int steady_state;
+	int selection_method;
+	unsigned int tournament_size;
+	double truncation;
+	int crossover;
+	int reserved;
+	unsigned long long population_size;
+	unsigned long long melody_length;
+	unsigned long long parent1_index;
+	unsigned long long parent2_index;
+	unsigned long long cache_slots;
+	unsigned long long cache_hits;
+	unsigned long long cache_misses;
+	unsigned long long notes_offset;	// population_size * melody_length notes
+	unsigned long long scores_offset;	// population_size ints
+	unsigned long long cache_offset;	// cache_slots pairs of check word and score
+	unsigned long long convergence_recorded;
+	unsigned long long convergence_samples;
+	unsigned long long convergence_restarts;
+	unsigned long long convergence_offset;	// convergence_samples samples, then convergence_restarts + 1 events
+	unsigned long long file_size;
+	unsigned long long checksum;		// of everything before it and everything after the header
+};
+
+// best and mean fitness of a generation in the ring of the convergence monitor
+struct CheckpointSample {
+	double mean;
+	int best;
+	int reserved;
+};
+
+// a restart of the run, or its stop (reason CONVERGENCE_NONE if it did not stop)
+struct CheckpointEvent {
+	unsigned long long generation;
+	double diversity;
+	int reason;
+	int best_score;
+};
+
+static size_t alignSection(size_t offset) {
+	return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+/**
+* 64-bit FNV style hash of bytes, continuing from h (the same mixing as melodyHash()).
+**/
+static unsigned long long hashBytes(const unsigned char* bytes, size_t count, unsigned long long h) {
+	const unsigned long long prime = 0x100000001b3ULL;
+	size_t i = 0;
+	for (; i + sizeof(unsigned long long) <= count; i += sizeof(unsigned long long)) {
+		unsigned long long word;
+		memcpy(&word, bytes + i, sizeof(word));
+		h = (h ^ word) * prime;
+		h ^= h >> 32;
+	}
+	for (; i < count; ++i)
+		h = (h ^ bytes[i]) * prime;
+	return h;
+}
+
+/**
+* True for a note of the packed format: a pitch class, an octave CFugue plays and no other bits.
+**/
+static bool validNote(Note note) {
+	return notePitchClass(note) < PITCH_CLASSES && noteOctave(note) <= MAX_OCTAVE
+		&& (note & ~0x7FF) == 0;
+}
+
+static unsigned long long imageChecksum(const unsigned char* image, size_t size) {
+	unsigned long long h = hashBytes(image, offsetof(CheckpointHeader, checksum), 0xcbf29ce484222325ULL);
+	return hashBytes(image + sizeof(CheckpointHeader), size - sizeof(CheckpointHeader), h);
+}
+
+void makeCheckpoint(const Population& population, const CheckpointState& state, std::vector<unsigned char>& image) {
+	const size_t size = population.individuals.size();
+	const size_t length = size ? population.individuals[0].size() : 0;
+
+	CheckpointHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.byte_order = BYTE_ORDER_MARK;
+	header.version = CHECKPOINT_VERSION;
+	header.note_size = sizeof(Note);
+	header.seed = state.seed;
+	header.generation = state.generation;
+	header.key_tonic = state.key.tonic;
+	header.key_scale = state.key.scale;
+	header.key_mela = state.key.mela;
+	header.steady_state = state.steady_state;
+	header.selection_method = population.selection.method;
+	header.tournament_size = population.selection.tournament_size;
+	header.truncation = population.selection.truncation;
+	header.crossover = population.crossover;
+	header.population_size = size;
+	header.melody_length = length;
+	header.parent1_index = population.parent1_index;
+	header.parent2_index = population.parent2_index;
+	header.cache_slots = fitness_cache.capacity();
+	header.cache_hits = fitness_cache.hits();
+	header.cache_misses = fitness_cache.misses();
+	header.notes_offset = alignSection(sizeof(CheckpointHeader));
+	header.scores_offset = alignSection(header.notes_offset + size * length * sizeof(Note));
+	header.convergence_recorded = state.convergence.recorded;
+	header.convergence_samples = state.convergence.best.size();
+	header.convergence_restarts = state.convergence.restarts.size();
+	header.convergence_offset = alignSection(header.scores_offset + size * sizeof(int));
+	const size_t samples_end = header.convergence_offset + header.convergence_samples * sizeof(CheckpointSample);
+	const size_t convergence_end = samples_end + (header.convergence_restarts + 1) * sizeof(CheckpointEvent);
+	header.cache_offset = alignSection(convergence_end);
+	header.file_size = header.cache_offset + header.cache_slots * 2 * sizeof(unsigned long long);
+
+	// the sections are written over whatever the reused storage held, so only the gaps are cleared
+	image.resize(header.file_size);
+	unsigned char* bytes = &image[0];
+	memcpy(bytes, &header, sizeof(header));
+	memset(bytes + sizeof(header), 0, header.notes_offset - sizeof(header));
+
+	unsigned char* notes = bytes + header.notes_offset;
+	for (size_t i = 0; i < size; ++i)
+		memcpy(notes + i * length * sizeof(Note), population.individuals[i].notes.data(), length * sizeof(Note));
+	size_t notes_end = header.notes_offset + size * length * sizeof(Note);
+	memset(bytes + notes_end, 0, header.scores_offset - notes_end);
+
+	if (size)
+		memcpy(bytes + header.scores_offset, &population.scores[0], size * sizeof(int));
+	size_t scores_end = header.scores_offset + size * sizeof(int);
+	memset(bytes + scores_end, 0, header.convergence_offset - scores_end);
+
+	CheckpointSample* samples = reinterpret_cast<CheckpointSample*>(bytes + header.convergence_offset);
+	for (size_t i = 0; i < header.convergence_samples; ++i) {
+		samples[i].mean = state.convergence.mean[i];
+		samples[i].best = state.convergence.best[i];
+		samples[i].reserved = 0;
+	}
+	CheckpointEvent* events = reinterpret_cast<CheckpointEvent*>(bytes + samples_end);
+	for (size_t i = 0; i <= header.convergence_restarts; ++i) {
+		const ConvergenceEvent& event = i < header.convergence_restarts ? state.convergence.restarts[i]
+			: state.convergence.stop;
+		events[i].generation = event.generation;
+		events[i].diversity = event.diversity;
+		events[i].reason = event.reason;
+		events[i].best_score = event.best_score;
+	}
+	memset(bytes + convergence_end, 0, header.cache_offset - convergence_end);
+
+	fitness_cache.saveSlots(reinterpret_cast<unsigned long long*>(bytes + header.cache_offset));
+}
+
+/**
+* Makes sure the written data of a file is on the disk.
+**/
+static bool syncFile(FILE* file) {
+#ifdef _WIN32
+	return _commit(_fileno(file)) == 0;
+#else
+	return fsync(fileno(file)) == 0;
+#endif
+}
+
+/**
+* Renames from over to in one step, so that to is either the old or the new file.
+**/
+static bool replaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	if (rename(from.c_str(), to.c_str()) != 0)
+		return false;
+	// the rename itself is only on the disk once the directory is
+	size_t slash = to.find_last_of('/');
+	std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : to.substr(0, slash));
+	int fd = ::open(directory.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		fsync(fd);
+		::close(fd);
+	}
+	return true;
+#endif
+}
+
+bool writeCheckpoint(const std::string& path, std::vector<unsigned char>& image) {
+	if (image.size() < sizeof(CheckpointHeader))
+		return false;
+	unsigned long long checksum = imageChecksum(&image[0], image.size());
+	memcpy(&image[offsetof(CheckpointHeader, checksum)], &checksum, sizeof(checksum));
+
+	const std::string temporary = path + ".tmp";
+	FILE* file = fopen(temporary.c_str(), "wb");
+	if (!file)
+		return false;
+	bool written = fwrite(&image[0], 1, image.size(), file) == image.size() && fflush(file) == 0 && syncFile(file);
+	if (fclose(file) != 0)
+		written = false;
+	if (!written || !replaceFile(temporary, path)) {
+		remove(temporary.c_str());
+		return false;
+	}
+	return true;
+}
+
+/**
+* A whole file mapped read-only into memory.
+**/
+class MappedFile {
+public:
+	MappedFile() : bytes(NULL), length(0) {
+#ifdef _WIN32
+		file = INVALID_HANDLE_VALUE;
+		mapping = NULL;
+#endif
+	}
+
+	~MappedFile() {
+#ifdef _WIN32
+		if (bytes)
+			UnmapViewOfFile(bytes);
+		if (mapping)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+#else
+		if (bytes)
+			munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+	}
+
+	// Returns false if the file cannot be read. An empty file maps to no bytes.
+	bool open(const std::string& path) {
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size))
+			return false;
+		length = (size_t)size.QuadPart;
+		if (length == 0)
+			return true;
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!mapping)
+			return false;
+		bytes = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		return bytes != NULL;
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			::close(fd);
+			return false;
+		}
+		length = (size_t)info.st_size;
+		void* address = length ? mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+		::close(fd);
+		if (address == MAP_FAILED)
+			return false;
+		bytes = static_cast<const unsigned char*>(address);
+		return true;
+#endif
+	}
+
+	const unsigned char* data() const { return bytes; }
+	size_t size() const { return length; }
+
+private:
+	MappedFile(const MappedFile&);				// not copyable
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char* bytes;
+	size_t length;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+};
+
+bool loadCheckpoint(const std::string& path, Population& population, CheckpointState& state, std::string& error) {
+	MappedFile file;
+	if (!file.open(path)) {
+		error = "cannot read checkpoint " + path;
+		return false;
+	}
+
+	CheckpointHeader header;
+	if (file.size() < sizeof(header)) {
+		error = path + " is not a checkpoint";
+		return false;
+	}
+	memcpy(&header, file.data(), sizeof(header));
+	if (memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0) {
+		error = path + " is not a checkpoint";
+		return false;
+	}
+	if (header.byte_order != BYTE_ORDER_MARK) {
+		error = path + " is a checkpoint of a machine with another byte order";
+		return false;
+	}
+	if (header.version != CHECKPOINT_VERSION || header.note_size != sizeof(Note)) {
+		error = path + " is a checkpoint of another version";
+		return false;
+	}
+
+	// every section must lie in the file, after the previous one
+	const unsigned long long size = header.population_size;
+	const unsigned long long length = header.melody_length;
+	if (header.file_size != file.size() || size == 0 || length == 0 || length > file.size() / size
+		|| header.notes_offset < sizeof(header) || header.scores_offset < header.notes_offset + size * length * sizeof(Note)
+		|| header.convergence_offset < header.scores_offset + size * sizeof(int)
+		|| header.convergence_offset > file.size()
+		|| header.convergence_samples > file.size() / sizeof(CheckpointSample)
+		|| header.convergence_restarts >= file.size() / sizeof(CheckpointEvent)
+		|| header.cache_offset < header.convergence_offset + header.convergence_samples * sizeof(CheckpointSample)
+			+ (header.convergence_restarts + 1) * sizeof(CheckpointEvent)
+		|| header.cache_offset > file.size()
+		|| header.cache_slots > (file.size() - header.cache_offset) / (2 * sizeof(unsigned long long))
+		|| header.parent1_index >= size || header.parent2_index >= size) {
+		error = path + " is truncated or damaged";
+		return false;
+	}
+	if (imageChecksum(file.data(), file.size()) != header.checksum) {
+		error = path + " is corrupt (checksum mismatch)";
+		return false;
+	}
+	if (header.key_scale < SCALE_MAJOR || header.key_scale > SCALE_MELAKARTA
+		|| header.selection_method < SELECTION_BEST_TWO || header.selection_method > SELECTION_TRUNCATION
+		|| header.crossover < CROSSOVER_ONE_POINT || header.crossover > CROSSOVER_UNIFORM) {
+		error = path + " has unknown settings";
+		return false;
+	}
+	const CheckpointSample* samples = reinterpret_cast<const CheckpointSample*>(file.data() + header.convergence_offset);
+	const CheckpointEvent* events = reinterpret_cast<const CheckpointEvent*>(samples + header.convergence_samples);
+	if (header.convergence_samples > header.convergence_recorded) {
+		error = path + " is corrupt (convergence history)";
+		return false;
+	}
+	for (size_t i = 0; i <= header.convergence_restarts; ++i) {
+		// only the stop may have no reason, for a run that did not stop
+		if (events[i].reason < (i < header.convergence_restarts ? CONVERGENCE_STALLED : CONVERGENCE_NONE)
+			|| events[i].reason > CONVERGENCE_COLLAPSED) {
+			error = path + " is corrupt (convergence history)";
+			return false;
+		}
+	}
+
+	// a key or notes out of range would index past the fitness tables
+	if (header.key_tonic < 0 || header.key_tonic >= PITCH_CLASSES
+		|| (header.key_scale == SCALE_MELAKARTA && (header.key_mela < 1 || header.key_mela > MELAKARTA_COUNT))) {
+		error = path + " is corrupt (key)";
+		return false;
+	}
+	// written so that a NaN fails too: it would reach the size of the truncation selection
+	if (header.tournament_size == 0 || !(header.truncation > 0 && header.truncation <= 1)) {
+		error = path + " is corrupt (selection)";
+		return false;
+	}
+	const Note* notes = reinterpret_cast<const Note*>(file.data() + header.notes_offset);
+	for (size_t i = 0; i < size * length; ++i) {
+		if (!validNote(notes[i])) {
+			error = path + " is corrupt (notes)";
+			return false;
+		}
+	}
+	population.individuals.resize(size);
+	for (size_t i = 0; i < size; ++i)
+		population.individuals[i].notes.assign(notes + i * length, notes + (i + 1) * length);
+	population.scores.resize(size);
+	memcpy(&population.scores[0], file.data() + header.scores_offset, size * sizeof(int));
+	population.next_individuals.assign(size, Melody(length));
+	population.spare_children.assign(size, Melody(length));
+	population.states_valid = false;
+
+	population.parent1_index = header.parent1_index;
+	population.parent1_score = population.scores[header.parent1_index];
+	population.parent2_index = header.parent2_index;
+	population.parent2_score = population.scores[header.parent2_index];
+	population.selection.method = (SelectionMethod)header.selection_method;
+	population.selection.tournament_size = header.tournament_size;
+	population.selection.truncation = header.truncation;
+	population.crossover = (CrossoverMethod)header.crossover;
+
+	state.seed = header.seed;
+	state.generation = header.generation;
+	state.key = Key(header.key_tonic, (ScaleType)header.key_scale, header.key_mela);
+	state.steady_state = header.steady_state;
+
+	ConvergenceHistory& convergence = state.convergence;
+	convergence.best.resize(header.convergence_samples);
+	convergence.mean.resize(header.convergence_samples);
+	for (size_t i = 0; i < header.convergence_samples; ++i) {
+		convergence.best[i] = samples[i].best;
+		convergence.mean[i] = samples[i].mean;
+	}
+	convergence.recorded = header.convergence_recorded;
+	convergence.restarts.resize(header.convergence_restarts);
+	for (size_t i = 0; i <= header.convergence_restarts; ++i) {
+		ConvergenceEvent& event = i < header.convergence_restarts ? convergence.restarts[i] : convergence.stop;
+		event.generation = events[i].generation;
+		event.diversity = events[i].diversity;
+		event.reason = (ConvergenceReason)events[i].reason;
+		event.best_score = events[i].best_score;
+	}
+
+	// the key clears the cache, so it goes first; a cache of another size starts out empty
+	setMelodyKey(state.key);
+	if (header.cache_slots == fitness_cache.capacity())
+		fitness_cache.loadSlots(reinterpret_cast<const unsigned long long*>(file.data() + header.cache_offset),
+			header.cache_hits, header.cache_misses);
+	return true;
+}
+
+CheckpointWriter::CheckpointWriter() : has_pending(false), closing(false), failed(false) {}
+
+CheckpointWriter::~CheckpointWriter() {
+	close();
+}
+
+void CheckpointWriter::open(const std::string& path) {
+	close();
+	this->path = path;
+	has_pending = false;
+	closing = false;
+	failed = false;
+	writer = std::thread(&CheckpointWriter::writerLoop, this);
+}
+
+void CheckpointWriter::save(const Population& population, const CheckpointState& state) {
+	makeCheckpoint(population, state, snapshot);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.swap(snapshot);
+		has_pending = true;
+	}
+	wake.notify_one();
+}
+
+bool CheckpointWriter::close() {
+	if (writer.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closing = true;
+		}
+		wake.notify_one();
+		writer.join();
+	}
+	return !failed;
+}
+
+void CheckpointWriter::writerLoop() {
+	std::vector<unsigned char> image;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return has_pending || closing; });
+			if (!has_pending)
+				break;
+			image.swap(pending);
+			has_pending = false;
+		}
+		if (!writeCheckpoint(path, image)) {
+			std::lock_guard<std::mutex> lock(mutex);
+			failed = true;
+		}
+	}
+}
@@ -0,0 +1,101 @@
+// Checkpoint.h
+//
+// Binary checkpoints of a single population GA run, to stop a long run and resume it later.
+//
+// A checkpoint is one file: a fixed size header followed by sections at 64 byte aligned offsets,
+// in the byte order of the machine that wrote it:
+//
+//   header | notes of every individual, back to back | scores (int) | convergence | fitness cache slots
+//
+// so every section can be used in place from a memory mapped file. A checkpoint is written to
+// PATH.tmp and renamed over PATH once it is complete, so a crash never leaves a partial one behind.
+//
+// The convergence section holds the ring of the convergence monitor, its restarts and
+// the stop of the run, if it stopped (see Convergence.h).
+//
+// The random streams are derived from the seed and the generation (see Random.h), so these two
+// numbers are the whole random state of a run, and a resumed run continues bit for bit.
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Convergence.h"
+#include "GeneticAlgorithm.h"
+
+/**
+* What a checkpoint holds besides the population and the fitness cache.
+**/
+struct CheckpointState {
+	unsigned long long seed;
+	unsigned long long generation;	// generations (or steady-state steps) done
+	Key key;
+	int steady_state;				// individuals replaced per steady-state step, 0 for generations
+	ConvergenceHistory convergence;	// see ConvergenceMonitor::save()
+
+	CheckpointState() : seed(0), generation(0), steady_state(0) {}
+};
+
+/**
+* Serializes the population, the fitness cache and the state into a checkpoint image.
+* The storage of image is reused.
+**/
+void makeCheckpoint(const Population& population, const CheckpointState& state, std::vector<unsigned char>& image);
+
+/**
+* Writes a checkpoint image to path, atomically: through a temporary file that replaces path
+* once it is on disk. Returns false if it cannot be written.
+**/
+bool writeCheckpoint(const std::string& path, std::vector<unsigned char>& image);
+
+/**
+* Restores a run from a checkpoint: the population (with its parents, selection and crossover
+* method), the state, the key of the melodies (see setMelodyKey) and the fitness cache.
+* Returns false and sets error if the file is missing, truncated, corrupt or of another format.
+**/
+bool loadCheckpoint(const std::string& path, Population& population, CheckpointState& state, std::string& error);
+
+/**
+* Writes checkpoints on a background thread. save() only takes a snapshot of the run; when the
+* previous checkpoint is still being written, a newer snapshot replaces the one waiting.
+**/
+class CheckpointWriter {
+public:
+	CheckpointWriter();
+	~CheckpointWriter();
+
+	/**
+	* Starts writing checkpoints to path.
+	**/
+	void open(const std::string& path);
+
+	/**
+	* Takes a snapshot of the run and queues it for the writer thread.
+	**/
+	void save(const Population& population, const CheckpointState& state);
+
+	/**
+	* Writes the queued snapshot and stops the writer thread.
+	* Returns false if any checkpoint could not be written.
+	**/
+	bool close();
+
+private:
+	CheckpointWriter(const CheckpointWriter&);				// not copyable
+	CheckpointWriter& operator=(const CheckpointWriter&);
+
+	void writerLoop();
+
+	std::string path;
+	std::thread writer;
+	std::vector<unsigned char> snapshot;	// filled by save()
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<unsigned char> pending;		// guarded by mutex
+	bool has_pending;						// guarded by mutex
+	bool closing;							// guarded by mutex
+	bool failed;							// guarded by mutex
+};
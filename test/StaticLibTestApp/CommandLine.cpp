@@ -0,0 +1,304 @@
+// CommandLine.cpp
+//
+// Command line options of the GA music program.
+
+#include "CommandLine.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+
+/**
+* Parses a whole argument as a number in [min, max].
+**/
+static bool parseNumber(const char* text, long long min, long long max, long long& value) {
+	if (!text || !*text)
+		return false;
+	char* end = NULL;
+	errno = 0;
+	value = strtoll(text, &end, 10);
+	return errno == 0 && *end == '\0' && value >= min && value <= max;
+}
+
+/**
+* Options that are followed by a value.
+**/
+static bool takesValue(const std::string& option) {
+	static const char* const options[] = { "--population", "--length", "--generations", "--islands",
+		"--migration-interval", "--seed", "--key", "--output", "--telemetry", "--steady-state",
+		"--selection", "--tournament-size", "--truncation", "--crossover", "--checkpoint", "--checkpoint-interval",
+		"--resume", "--export-midi", "--export-every", "--tracks", "--converge", "--min-improvement", "--min-diversity",
+		"--restarts" };
+	for (size_t i = 0; i < sizeof(options) / sizeof(options[0]); ++i)
+		if (option == options[i])
+			return true;
+	return false;
+}
+
+bool parseCommandLine(int argc, char* argv[], RunOptions& options, bool& help, std::string& error) {
+	int positional = 0;
+	help = false;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+		long long number = 0;
+
+		if (arg == "-h" || arg == "--help") {
+			help = true;
+			return true;
+		}
+		else if (arg == "--headless") {
+			options.headless = true;
+			continue;
+		}
+		else if (arg == "--processes") {
+			options.island_processes = true;
+			continue;
+		}
+		else if (arg == "--pin-cpus") {
+			options.pin_cpus = true;
+			continue;
+		}
+		else if (arg == "--quiet") {
+			options.quiet = true;
+			continue;
+		}
+		else if (arg == "--audition") {
+			options.audition = true;
+			continue;
+		}
+		else if (arg == "--multi-objective") {
+			options.multi_objective = true;
+			continue;
+		}
+		else if (arg.compare(0, 2, "--") != 0) {
+			// the legacy arguments: MIDI port, then timer resolution
+			if (positional >= 2 || !parseNumber(argv[i], -1, INT_MAX, number)) {
+				error = "unexpected argument " + arg;
+				return false;
+			}
+			if (positional++ == 0) {
+				options.port = (int)number;
+				options.port_given = true;
+			}
+			else
+				options.timer_resolution = (int)number;
+			continue;
+		}
+
+		if (!takesValue(arg)) {
+			error = "unknown option " + arg;
+			return false;
+		}
+		if (!value) {
+			error = "missing value for " + arg;
+			return false;
+		}
+		++i;
+		bool valid = true;
+		if (arg == "--population") {
+			valid = parseNumber(value, 2, INT_MAX, number);
+			options.population_size = (int)number;
+		}
+		else if (arg == "--length") {
+			valid = parseNumber(value, 2, INT_MAX, number);
+			options.melody_length = (int)number;
+		}
+		else if (arg == "--generations") {
+			valid = parseNumber(value, 0, INT_MAX, number);
+			options.generations = (int)number;
+		}
+		else if (arg == "--islands") {
+			valid = parseNumber(value, 1, 4096, number);
+			options.islands = (int)number;
+		}
+		else if (arg == "--migration-interval") {
+			valid = parseNumber(value, 1, INT_MAX, number);
+			options.migration_interval = (int)number;
+		}
+		else if (arg == "--steady-state") {
+			valid = parseNumber(value, 1, INT_MAX, number);
+			options.steady_state = (int)number;
+		}
+		else if (arg == "--selection") {
+			const std::string method = value;
+			if (method == "best2")
+				options.selection.method = SELECTION_BEST_TWO;
+			else if (method == "tournament")
+				options.selection.method = SELECTION_TOURNAMENT;
+			else if (method == "rank")
+				options.selection.method = SELECTION_RANK;
+			else if (method == "truncation")
+				options.selection.method = SELECTION_TRUNCATION;
+			else
+				valid = false;
+		}
+		else if (arg == "--crossover") {
+			const std::string method = value;
+			if (method == "one-point")
+				options.crossover = CROSSOVER_ONE_POINT;
+			else if (method == "two-point")
+				options.crossover = CROSSOVER_TWO_POINT;
+			else if (method == "uniform")
+				options.crossover = CROSSOVER_UNIFORM;
+			else
+				valid = false;
+		}
+		else if (arg == "--tournament-size") {
+			valid = parseNumber(value, 1, INT_MAX, number);
+			options.selection.tournament_size = (unsigned int)number;
+		}
+		else if (arg == "--truncation") {
+			char* end = NULL;
+			options.selection.truncation = strtod(value, &end);
+			valid = *value && *end == '\0' && options.selection.truncation > 0 && options.selection.truncation <= 1;
+		}
+		else if (arg == "--seed") {
+			char* end = NULL;
+			errno = 0;
+			options.seed = strtoull(value, &end, 0);
+			valid = *value && errno == 0 && *end == '\0';
+			options.seed_given = true;
+		}
+		else if (arg == "--key")
+			valid = parseKey(value, options.key);
+		else if (arg == "--checkpoint-interval") {
+			valid = parseNumber(value, 1, INT_MAX, number);
+			options.checkpoint_interval = (int)number;
+		}
+		else if (arg == "--checkpoint") {
+			valid = *value != '\0';
+			options.checkpoint = value;
+		}
+		else if (arg == "--resume") {
+			valid = *value != '\0';
+			options.resume = value;
+		}
+		else if (arg == "--export-midi") {
+			valid = *value != '\0';
+			options.export_midi = value;
+		}
+		else if (arg == "--export-every") {
+			valid = parseNumber(value, 0, INT_MAX, number);
+			options.export_every = (int)number;
+		}
+		else if (arg == "--tracks") {
+			// every track gets its own MIDI channel, and one of the 16 is for percussion
+			valid = parseNumber(value, 1, 15, number);
+			options.tracks = (int)number;
+		}
+		else if (arg == "--converge") {
+			valid = parseNumber(value, 1, INT_MAX, number);
+			options.convergence.window = (int)number;
+		}
+		else if (arg == "--min-improvement") {
+			// in points, kept in tenths like the scores
+			char* end = NULL;
+			const double points = strtod(value, &end);
+			valid = *value && *end == '\0' && points >= 0 && points <= INT_MAX / SCORE_SCALE;
+			options.convergence.min_improvement = valid ? (int)(points * SCORE_SCALE + 0.5) : 0;
+		}
+		else if (arg == "--min-diversity") {
+			char* end = NULL;
+			options.convergence.min_diversity = strtod(value, &end);
+			valid = *value && *end == '\0' && options.convergence.min_diversity >= 0 && options.convergence.min_diversity <= 1;
+		}
+		else if (arg == "--restarts") {
+			valid = parseNumber(value, 0, INT_MAX, number);
+			options.convergence.restarts = (int)number;
+		}
+		else if (arg == "--telemetry") {
+			valid = *value != '\0';
+			options.telemetry = value;
+		}
+		else {	// --output
+			valid = *value != '\0';
+			options.output = value;
+		}
+		if (!valid) {
+			error = "bad value for " + arg + ": " + value;
+			return false;
+		}
+	}
+	if (options.islands > 1 && (!options.checkpoint.empty() || !options.resume.empty() || !options.export_midi.empty())) {
+		error = "checkpoints and MIDI export need a single population, not --islands";
+		return false;
+	}
+	if (options.islands > 1 && !options.telemetry.empty()) {
+		error = "--telemetry records the generations of a single population, not --islands";
+		return false;
+	}
+	if (options.islands > 1 && options.steady_state > 0) {
+		error = "--steady-state evolves a single population, not --islands";
+		return false;
+	}
+	if (options.pin_cpus && !options.island_processes) {
+		error = "--pin-cpus binds island processes to CPUs, it needs --processes";
+		return false;
+	}
+	if (options.audition && (options.headless || options.islands > 1)) {
+		error = "--audition plays a single population on the MIDI port, not with --headless or --islands";
+		return false;
+	}
+	if (options.tracks > 1 && (options.islands > 1 || options.steady_state > 0 || !options.checkpoint.empty()
+		|| !options.resume.empty() || !options.export_midi.empty() || !options.telemetry.empty() || options.audition)) {
+		error = "--tracks evolves one population per voice, without --islands, --steady-state, checkpoints, "
+			"MIDI export, telemetry or --audition";
+		return false;
+	}
+	if (options.multi_objective && (options.islands > 1 || options.steady_state > 0 || options.tracks > 1
+		|| !options.checkpoint.empty() || !options.resume.empty() || !options.export_midi.empty()
+		|| !options.telemetry.empty() || options.audition)) {
+		error = "--multi-objective evolves a single population, without --islands, --steady-state, --tracks, "
+			"checkpoints, MIDI export, telemetry or --audition";
+		return false;
+	}
+	if (options.convergence.window > 0 && (options.islands > 1 || options.tracks > 1 || options.multi_objective)) {
+		error = "--converge watches a single population, not --islands, --tracks or --multi-objective";
+		return false;
+	}
+	return true;
+}
+
+std::string usage(const char* program) {
+	std::string text = "usage: ";
+	text += program;
+	text += " [port [timer]] [options]\n"
+		"  --headless              run without MIDI device or console input, write the results to files\n"
+		"  --population N          individuals per population (default 10)\n"
+		"  --length N              notes per melody (default 12)\n"
+		"  --generations N         generations to run (default 1000)\n"
+		"  --seed N                random seed (default: current time)\n"
+		"  --key NAME              key to compose in, e.g. \"C major\", \"A minor\", \"MELA_65\"\n"
+		"  --islands N             evolve N populations that exchange their best melodies\n"
+		"  --migration-interval N  generations between migrations (default 10)\n"
+		"  --processes             run each island in its own process\n"
+		"  --pin-cpus              bind each island process to a CPU (island mod CPU count)\n"
+		"  --steady-state K        replace the worst K individuals in place each step (generation)\n"
+		"  --selection METHOD      parent selection: best2 (default), tournament, rank or truncation\n"
+		"  --tournament-size N     individuals per tournament (default 3)\n"
+		"  --truncation F          fraction of the population truncation selection keeps (default 0.2)\n"
+		"  --crossover METHOD      one-point (default), two-point or uniform\n"
+		"  --output PREFIX         headless result files PREFIX.txt and PREFIX.mid (default ga_run)\n"
+		"  --telemetry FILE        write per generation statistics to FILE (.csv for CSV, JSON lines otherwise)\n"
+		"  --quiet                 do not print every generation\n"
+		"  --checkpoint FILE       save the run to FILE every --checkpoint-interval generations and at the end\n"
+		"  --checkpoint-interval N generations between checkpoints (default 100)\n"
+		"  --resume FILE           continue the run saved in FILE up to --generations; its settings replace\n"
+		"                          the population, length, seed, key, selection, crossover and steady-state options\n"
+		"  --export-midi PREFIX    save best melodies to PREFIX_<generation>.mid in the background\n"
+		"  --export-every N        export the best melody of every Nth generation (default 0: every new best)\n"
+		"  --audition              play each new best in the background while the generations keep running\n"
+		"  --tracks N              evolve N voices that harmonize with each other, one population each (default 1)\n"
+		"  --multi-objective       keep the fitness terms as separate objectives and evolve their Pareto front,\n"
+		"                          listed in PREFIX_front.csv by headless runs\n"
+		"  --converge N            stop once neither the best nor the mean fitness improved over N generations\n"
+		"  --min-improvement F     fitness gain over the --converge window that counts as improving (default 0.1)\n"
+		"  --min-diversity F       fraction of distinct melodies below which a stalled population has collapsed\n"
+		"                          (default 0.1), reported with the reason of the stop\n"
+		"  --restarts N            restart a stalled run from new melodies, keeping its best, N times before\n"
+		"                          stopping it (default 0)\n";
+	return text;
+}
@@ -0,0 +1,69 @@
+// CommandLine.h
+//
+// Command line options of the GA music program.
+//
+//   testCFugueLib [port [timer]] [--headless] [--population N] [--length N] [--generations N]
+//                 [--seed N] [--key NAME] [--islands N] [--migration-interval N] [--processes]
+//                 [--pin-cpus] [--steady-state K] [--selection METHOD] [--tournament-size N] [--truncation F]
+//                 [--crossover METHOD]
+//                 [--output PREFIX] [--telemetry FILE] [--quiet]
+//                 [--checkpoint FILE] [--checkpoint-interval N] [--resume FILE]
+//                 [--export-midi PREFIX] [--export-every N] [--audition] [--tracks N]
+//                 [--multi-objective] [--converge N] [--min-improvement F] [--min-diversity F]
+//                 [--restarts N]
+//
+// The plain port and timer resolution arguments work as before. --headless runs the GA without
+// a MIDI device and without waiting for input, and writes the results to PREFIX.txt and PREFIX.mid.
+
+#pragma once
+
+#include <string>
+#include "Convergence.h"
+#include "GeneticAlgorithm.h"
+
+struct RunOptions {
+	bool headless;					// no MIDI device, no console input, results go to files
+	int population_size;
+	int melody_length;
+	int generations;
+	unsigned long long seed;
+	bool seed_given;				// false: seeded from the current time
+	Key key;
+	int islands;					// more than 1 evolves that many populations (island model)
+	int migration_interval;
+	bool island_processes;			// run each island in its own process
+	bool pin_cpus;					// bind each island process to a CPU
+	int steady_state;				// more than 0: steady-state GA replacing this many individuals per step
+	SelectionOptions selection;
+	CrossoverMethod crossover;
+	std::string output;				// prefix of the result files
+	std::string telemetry;			// per generation telemetry file (.csv or JSON lines), empty for none
+	bool quiet;						// no per generation console output
+	std::string checkpoint;			// checkpoint file written during the run, empty for none
+	int checkpoint_interval;		// generations between checkpoints
+	std::string resume;				// checkpoint to continue from, empty to start a new run
+	std::string export_midi;		// prefix of the MIDI files of the best melodies, empty for none
+	int export_every;				// export the best melody of every Nth generation, 0: every new best
+	bool audition;					// play every new best in the background while evolving
+	int tracks;						// more than 1 evolves an arrangement of that many voices (see MultiTrack.h)
+	bool multi_objective;			// evolve the Pareto front of the fitness terms (see MultiObjective.h)
+	ConvergenceOptions convergence;	// early stop and restarts of a stalled run, off unless --converge is given
+	int port;						// MIDI output port
+	bool port_given;				// false: listed and chosen interactively
+	int timer_resolution;
+
+	RunOptions() : headless(false), population_size(10), melody_length(12), generations(1000), seed(0),
+		seed_given(false), islands(1), migration_interval(10), island_processes(false), pin_cpus(false), steady_state(0), crossover(CROSSOVER_ONE_POINT), output("ga_run"),
+		quiet(false), checkpoint_interval(100), export_every(0), audition(false), tracks(1), multi_objective(false), port(0), port_given(false), timer_resolution(20) {}
+};
+
+/**
+* Parses the command line into options. Returns false and sets error for an unknown option
+* or a bad value. help is set for -h / --help.
+**/
+bool parseCommandLine(int argc, char* argv[], RunOptions& options, bool& help, std::string& error);
+
+/**
+* Text listing the options, for --help and command line errors.
+**/
+std::string usage(const char* program);
@@ -0,0 +1,89 @@
+// Convergence.cpp
+//
+// Convergence detection for single population runs.
+
+#include "Convergence.h"
+
+#include <algorithm>
+
+ConvergenceMonitor::ConvergenceMonitor(const ConvergenceOptions& options) : options(options),
+	best(options.window + 1), mean(options.window + 1), recorded(0) {}
+
+bool ConvergenceMonitor::update(Population& population, unsigned long long seed, unsigned long long generation,
+	ThreadPool* pool) {
+	if (!enabled() || population.scores.empty())
+		return false;
+
+	double sum = 0;
+	for (size_t i = 0; i < population.scores.size(); ++i)
+		sum += population.scores[i];
+	const size_t slot = recorded % best.size();
+	best[slot] = population.parent1_score;
+	mean[slot] = sum / population.scores.size();
+	if (++recorded < best.size())
+		return false;
+
+	// the oldest generation of the ring is the one a window ago
+	const size_t oldest = recorded % best.size();
+	if (best[slot] - best[oldest] >= options.min_improvement || mean[slot] - mean[oldest] >= options.min_improvement)
+		return false;
+
+	ConvergenceEvent event;
+	event.generation = generation;
+	event.best_score = population.parent1_score;
+	event.diversity = diversity(population);
+	event.reason = event.diversity < options.min_diversity ? CONVERGENCE_COLLAPSED : CONVERGENCE_STALLED;
+	if ((int)restart_events.size() < options.restarts) {
+		restart_events.push_back(event);
+		restartPopulation(population, seed, generation, pool);
+		recorded = 0;
+		return false;
+	}
+	stop_event = event;
+	return true;
+}
+
+void ConvergenceMonitor::save(ConvergenceHistory& history) const {
+	const size_t count = std::min(recorded, best.size());
+	history.best.resize(count);
+	history.mean.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		const size_t slot = (recorded - count + i) % best.size();
+		history.best[i] = best[slot];
+		history.mean[i] = mean[slot];
+	}
+	history.recorded = recorded;
+	history.restarts = restart_events;
+	history.stop = stop_event;
+}
+
+void ConvergenceMonitor::restore(const ConvergenceHistory& history) {
+	const size_t count = std::min(history.best.size(), best.size());
+	recorded = (size_t)history.recorded - count;
+	for (size_t i = history.best.size() - count; i < history.best.size(); ++i) {
+		const size_t slot = recorded++ % best.size();
+		best[slot] = history.best[i];
+		mean[slot] = history.mean[i];
+	}
+	restart_events = history.restarts;
+	stop_event = history.stop;
+}
+
+double ConvergenceMonitor::diversity(const Population& population) {
+	hashes.resize(population.individuals.size());
+	for (size_t i = 0; i < hashes.size(); ++i)
+		hashes[i] = melodyHash(population.individuals[i]);
+	std::sort(hashes.begin(), hashes.end());
+	return (std::unique(hashes.begin(), hashes.end()) - hashes.begin()) / (double)hashes.size();
+}
+
+const char* convergenceReasonName(ConvergenceReason reason) {
+	switch (reason) {
+	case CONVERGENCE_STALLED:
+		return "stalled";
+	case CONVERGENCE_COLLAPSED:
+		return "collapsed";
+	default:
+		return "none";
+	}
+}
@@ -0,0 +1,103 @@
+// Convergence.h
+//
+// Convergence detection for single population runs, to stop (or restart) a run once it no longer
+// improves instead of running out every generation.
+//
+// The monitor keeps the best and mean fitness of the last window + 1 generations in a ring. When
+// neither has improved by min_improvement over the window, the population has stalled. Only then
+// is its diversity (the fraction of distinct melodies) measured, to tell a population that has
+// collapsed onto copies of a few melodies from one that is still spread out on a plateau. A
+// stalled population is restarted from new random melodies, keeping its best, while restarts are
+// left; after that the run stops.
+
+#pragma once
+
+#include <vector>
+#include "GeneticAlgorithm.h"
+
+enum ConvergenceReason {
+	CONVERGENCE_NONE,
+	CONVERGENCE_STALLED,		// no improvement over the window
+	CONVERGENCE_COLLAPSED		// no improvement, and the diversity fell below min_diversity
+};
+
+struct ConvergenceOptions {
+	int window;					// generations fitness has to improve over, 0 turns the monitor off
+	int min_improvement;		// in tenths, of the best or the mean fitness
+	double min_diversity;		// fraction of distinct melodies below which a population has collapsed
+	int restarts;				// stalls that restart the population before one stops the run
+
+	ConvergenceOptions() : window(0), min_improvement(1), min_diversity(0.1), restarts(0) {}
+};
+
+/**
+* A stall the monitor acted on.
+**/
+struct ConvergenceEvent {
+	unsigned long long generation;
+	ConvergenceReason reason;
+	int best_score;				// in tenths
+	double diversity;
+
+	ConvergenceEvent() : generation(0), reason(CONVERGENCE_NONE), best_score(0), diversity(0) {}
+};
+
+/**
+* What a monitor has seen of a run, to carry it over a checkpoint (see Checkpoint.h).
+**/
+struct ConvergenceHistory {
+	std::vector<int> best;			// best and mean fitness of the generations in the ring, oldest first
+	std::vector<double> mean;
+	unsigned long long recorded;	// generations since the start or the last restart
+	std::vector<ConvergenceEvent> restarts;
+	ConvergenceEvent stop;			// reason CONVERGENCE_NONE unless the run stopped
+
+	ConvergenceHistory() : recorded(0) {}
+
+	bool stopped() const { return stop.reason != CONVERGENCE_NONE; }
+};
+
+class ConvergenceMonitor {
+public:
+	explicit ConvergenceMonitor(const ConvergenceOptions& options = ConvergenceOptions());
+
+	bool enabled() const { return options.window > 0; }
+
+	/**
+	* Records the population after a generation. When it has stalled, restarts it if restarts are
+	* left (see restartPopulation()) and returns false, otherwise returns true: the run should stop.
+	* Costs a pass over the scores per generation, and a sort of the melody hashes per stall.
+	**/
+	bool update(Population& population, unsigned long long seed, unsigned long long generation, ThreadPool* pool);
+
+	const std::vector<ConvergenceEvent>& restarts() const { return restart_events; }
+	bool stopped() const { return stop_event.reason != CONVERGENCE_NONE; }
+	const ConvergenceEvent& stop() const { return stop_event; }
+
+	/**
+	* Copies the ring and the events into history, reusing its storage.
+	**/
+	void save(ConvergenceHistory& history) const;
+
+	/**
+	* Continues from a saved history. With another window than the saved run, the latest
+	* generations of the history that fit in the ring are kept.
+	**/
+	void restore(const ConvergenceHistory& history);
+
+private:
+	double diversity(const Population& population);
+
+	ConvergenceOptions options;
+	std::vector<int> best;					// ring of the last window + 1 generations
+	std::vector<double> mean;
+	size_t recorded;						// generations in the ring since the start or the last restart
+	std::vector<unsigned long long> hashes;	// scratch for measuring the diversity
+	std::vector<ConvergenceEvent> restart_events;
+	ConvergenceEvent stop_event;
+};
+
+/**
+* Name of a reason, e.g. "stalled".
+**/
+const char* convergenceReasonName(ConvergenceReason reason);
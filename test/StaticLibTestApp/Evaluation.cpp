@@ -0,0 +1,26 @@
+// Evaluation.cpp
+//
+// Parallel fitness evaluation of a whole population.
+
+#include "Evaluation.h"
+#include "BatchFitness.h"
+#include "FitnessCache.h"
+#include "ThreadPool.h"
+
+void evaluatePopulation(ThreadPool& pool, FitnessCache& cache,
+	const std::vector<Melody>& population, std::vector<int>& scores) {
+	scores.resize(population.size());
+	pool.parallelFor(population.size(), 0, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i)
+			scores[i] = cache.score(population[i]);
+	});
+}
+
+void evaluatePopulation(ThreadPool& pool, const PopulationColumns& columns, std::vector<int>& scores) {
+	scores.resize(columns.count);
+	const size_t blocks = (columns.count + BATCH_LANES - 1) / BATCH_LANES;
+	pool.parallelFor(blocks, 0, [&](size_t begin, size_t end) {
+		size_t last = end * BATCH_LANES < columns.count ? end * BATCH_LANES : columns.count;
+		batchFitness(columns, begin * BATCH_LANES, last, scores.data());
+	});
+}
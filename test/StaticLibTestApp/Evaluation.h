@@ -0,0 +1,27 @@
+// Evaluation.h
+//
+// Parallel fitness evaluation of a whole population.
+
+#pragma once
+
+#include <vector>
+#include "Melody.h"
+
+class FitnessCache;
+class ThreadPool;
+struct PopulationColumns;
+
+/**
+* Scores every melody of the population (in tenths, see fitnessScore()) on the thread pool,
+* going through the shared fitness cache. scores[i] always belongs to population[i], so the
+* result does not depend on the number of threads or on how the work was chunked.
+**/
+void evaluatePopulation(ThreadPool& pool, FitnessCache& cache,
+	const std::vector<Melody>& population, std::vector<int>& scores);
+
+/**
+* Scores a column-wise population with the batch fitness kernel on the thread pool.
+* Each thread scores whole SIMD blocks, and scores[i] always belongs to individual i.
+* Meant for large populations where a full re-score is cheaper than cache lookups.
+**/
+void evaluatePopulation(ThreadPool& pool, const PopulationColumns& columns, std::vector<int>& scores);
@@ -0,0 +1,147 @@
+// Fitness.cpp
+//
+// Melody fitness function and incremental (delta) re-scoring after a point mutation.
+
+#include "Fitness.h"
+#include "FitnessTerms.h"
+
+const FitnessTables* fitness_tables = &ScoreTables<DefaultFitness>::tables;
+
+int fitnessScore(const Note* notes, size_t length) {
+	// consonant intervals, stepwise motion, repeats, the tonic at both ends and the variety of notes used
+	return DefaultFitness::score(notes, length);
+}
+
+void initFitnessState(FitnessState& state, const Melody& melody) {
+	state.score = 0;
+	state.unique_count = 0;
+	for (int pc = 0; pc < PITCH_CLASSES; ++pc)
+		state.pitch_class_counts[pc] = 0;
+	state.pair_scores.assign(melody.size() > 1 ? melody.size() - 1 : 0, 0);
+
+	if (melody.empty())
+		return;
+
+	for (size_t i = 0; i + 1 < melody.size(); ++i) {
+		state.pair_scores[i] = pairScore(melody[i], melody[i + 1]);
+		state.score += state.pair_scores[i];
+		if (state.pitch_class_counts[notePitchClass(melody[i])]++ == 0)
+			++state.unique_count;
+	}
+	state.score += endpointScore(melody.front(), melody.back());
+	state.score += varietyScore(state.unique_count);
+}
+
+/**
+* Helper that computes everything that changes when the note at position becomes new_note.
+* Returns the new total score and the new unique note count.
+**/
+static int rescore(const FitnessState& state, const Melody& melody, size_t position, Note new_note,
+	int& new_left_pair, int& new_right_pair, int& new_unique_count) {
+	const size_t last = melody.size() - 1;
+	const Note old_note = melody[position];
+	int score = state.score;
+
+	// The (up to) two intervals touching the position
+	if (position > 0) {
+		new_left_pair = pairScore(melody[position - 1], new_note);
+		score += new_left_pair - state.pair_scores[position - 1];
+	}
+	if (position < last) {
+		new_right_pair = pairScore(new_note, melody[position + 1]);
+		score += new_right_pair - state.pair_scores[position];
+	}
+
+	// The tonic bonuses, when the position is one of the endpoints
+	if (position == 0 || position == last) {
+		Note first = (position == 0) ? new_note : melody.front();
+		Note last_note = (position == last) ? new_note : melody.back();
+		score += endpointScore(first, last_note) - endpointScore(melody.front(), melody.back());
+	}
+
+	// The unique note count (the last note is not part of it, see fitnessScore)
+	new_unique_count = state.unique_count;
+	int old_pc = notePitchClass(old_note);
+	int new_pc = notePitchClass(new_note);
+	if (position < last && old_pc != new_pc) {
+		if (state.pitch_class_counts[old_pc] == 1)
+			--new_unique_count;
+		if (state.pitch_class_counts[new_pc] == 0)
+			++new_unique_count;
+		score += varietyScore(new_unique_count) - varietyScore(state.unique_count);
+	}
+	return score;
+}
+
+int rescoreNoteChange(const FitnessState& state, const Melody& melody, size_t position, Note new_note) {
+	int left_pair = 0, right_pair = 0, unique_count = 0;
+	return rescore(state, melody, position, new_note, left_pair, right_pair, unique_count);
+}
+
+void applyNoteChange(FitnessState& state, Melody& melody, size_t position, Note new_note) {
+	const size_t last = melody.size() - 1;
+	int left_pair = 0, right_pair = 0, unique_count = 0;
+	state.score = rescore(state, melody, position, new_note, left_pair, right_pair, unique_count);
+	state.unique_count = unique_count;
+
+	if (position > 0)
+		state.pair_scores[position - 1] = left_pair;
+	if (position < last) {
+		state.pair_scores[position] = right_pair;
+		--state.pitch_class_counts[notePitchClass(melody[position])];
+		++state.pitch_class_counts[notePitchClass(new_note)];
+	}
+	melody[position] = new_note;
+}
+
+void crossoverFitnessState(const FitnessState& outer_state, const Melody& outer, const FitnessState& inner_state,
+	const Melody& inner, size_t begin, size_t end, FitnessState& state) {
+	const size_t length = outer.size();
+	// a segment at either end: start from the parent the child has most of its notes from
+	if ((begin == 0 || end == length) && end - begin > length / 2) {
+		if (begin == 0)
+			crossoverFitnessState(inner_state, inner, outer_state, outer, end, length, state);
+		else
+			crossoverFitnessState(inner_state, inner, outer_state, outer, 0, begin, state);
+		return;
+	}
+	// assigning the vector reuses the storage of state
+	state = outer_state;
+	if (begin >= end)
+		return;
+	const size_t last = length - 1;
+	int* pair_scores = &state.pair_scores[0];
+
+	// The pairs within [begin, end) are the ones of inner, only the two across begin and end are new
+	int score = state.score;
+	for (size_t i = begin; i + 1 < end; ++i)
+		score += inner_state.pair_scores[i] - pair_scores[i];
+	std::copy(inner_state.pair_scores.begin() + begin, inner_state.pair_scores.begin() + (end - 1), pair_scores + begin);
+	if (begin > 0) {
+		const int pair = pairScore(outer[begin - 1], inner[begin]);
+		score += pair - pair_scores[begin - 1];
+		pair_scores[begin - 1] = pair;
+	}
+	if (end < length) {
+		const int pair = pairScore(inner[end - 1], outer[end]);
+		score += pair - pair_scores[end - 1];
+		pair_scores[end - 1] = pair;
+	}
+
+	// The tonic bonuses, when an endpoint comes from inner
+	if (begin == 0 || end == length) {
+		Note first = (begin == 0) ? inner.front() : outer.front();
+		Note last_note = (end == length) ? inner.back() : outer.back();
+		score += endpointScore(first, last_note) - endpointScore(outer.front(), outer.back());
+	}
+
+	// The unique note count, over every note but the last
+	for (size_t i = begin; i < end && i < last; ++i) {
+		--state.pitch_class_counts[notePitchClass(outer[i])];
+		++state.pitch_class_counts[notePitchClass(inner[i])];
+	}
+	state.unique_count = 0;
+	for (int pc = 0; pc < PITCH_CLASSES; ++pc)
+		state.unique_count += state.pitch_class_counts[pc] != 0;
+	state.score = score + varietyScore(state.unique_count) - varietyScore(outer_state.unique_count);
+}
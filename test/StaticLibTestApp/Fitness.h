@@ -0,0 +1,202 @@
+// Fitness.h
+//
+// Melody fitness function and incremental (delta) re-scoring after a point mutation.
+//
+// Scores are accumulated as integers in tenths of a point. Every weight of the fitness
+// function is a multiple of 0.1, so incremental updates are exact and never drift from
+// a full evaluation. The delta re-scoring and the batch kernel (BatchFitness.h) score in the
+// key of the run, from the tables in fitness_tables, so they agree with fitness_cache.
+
+#pragma once
+
+#include <vector>
+#include "Melody.h"
+
+// Number of score units per fitness point
+const int SCORE_SCALE = 10;
+
+/***
+* Helper function to calculate the appropriate interval given two notes.
+* Notes are packed with their octave, so big leaps across octaves are measured
+* using the difference between the absolute semitones.
+***/
+constexpr int calculateInterval(Note note1, Note note2) {
+	int diff = noteSemitone(note2) - noteSemitone(note1);
+	return diff < 0 ? -diff : diff;
+}
+
+/**
+* Score (in tenths) of the consonance of an interval (in semitones) between adjacent notes,
+* with a penalty for large leaps.
+* constexpr so that the key specific score tables can be generated at compile time.
+**/
+constexpr int consonanceScore(int interval) {
+	int score = 0;
+
+	if (interval == 0 || interval == 5 || interval == 7) { // Unison, perfect fourth, perfect fifth
+		score += 10;
+	}
+	else if (interval == 4 || interval == 9) { // Major third, Major sixth
+		score += 7;
+	}
+	else if (interval == 12) { // Octave
+		score += 15;
+	}
+	if (interval > 7) { // Penalize large jumps
+		score -= 5;
+	}
+	return score;
+}
+
+/**
+* Score (in tenths) for stepwise motion (small interval changes) between adjacent notes.
+**/
+constexpr int stepScore(int interval) {
+	return (interval == 1 || interval == 2) ? 6 : 0; // Half step or whole step
+}
+
+/**
+* Score (in tenths) awarded for an interval (in semitones) between adjacent notes.
+**/
+constexpr int intervalScore(int interval) {
+	return consonanceScore(interval) + stepScore(interval);
+}
+
+// Score (in tenths) deducted when a note is repeated
+const int REPEAT_PENALTY = 2;
+
+/**
+* Number of pitch classes in a bit set of pitch classes.
+**/
+constexpr int countPitchClasses(unsigned int pitch_class_mask) {
+	int count = 0;
+	for (; pitch_class_mask != 0; pitch_class_mask &= pitch_class_mask - 1)
+		++count;
+	return count;
+}
+
+/**
+* Score (in tenths) for the number of distinct pitch classes used.
+**/
+constexpr int varietyScore(int unique_count) {
+	return 5 * unique_count;
+}
+
+// Octave differences covered by the pair table (-2 .. 2)
+const int OCTAVE_DELTAS = 5;
+
+/**
+* Score (in tenths) of every pair of adjacent notes, indexed by pairIndex(from, to).
+**/
+struct PairScoreMatrix {
+	signed char scores[OCTAVE_DELTAS * PITCH_CLASSES * PITCH_CLASSES];
+};
+
+/**
+* Index of a pair of notes into a PairScoreMatrix. Octave differences are clamped to [-2, 2]:
+* any larger leap is more than an octave away, where the interval rules no longer change.
+**/
+constexpr int pairIndex(Note from, Note to) {
+	int delta = noteOctave(to) - noteOctave(from);
+	delta = delta < -2 ? -2 : delta;
+	delta = delta > 2 ? 2 : delta;
+	return ((delta + 2) * PITCH_CLASSES + notePitchClass(from)) * PITCH_CLASSES + notePitchClass(to);
+}
+
+/**
+* A fitness function as tables, for scoring a melody piece by piece: the score of every pair of
+* adjacent notes, and of every first and last note (the tonic bonuses and penalties), indexed by
+* first * PITCH_CLASSES + last. The variety of pitch classes is scored by varietyScore().
+* Generated at compile time from a composition of fitness terms, see tabulateFitness().
+**/
+struct FitnessTables {
+	PairScoreMatrix pairs;
+	signed char endpoints[PITCH_CLASSES * PITCH_CLASSES];
+};
+
+// Tables of the fitness of the run: of fitnessScore() unless setMelodyKey() picks a key
+extern const FitnessTables* fitness_tables;
+
+/**
+* Score (in tenths) contributed by one pair of adjacent notes in the fitness of the run: the
+* interval reward/penalty, the repeated note penalty and, in a key, the out of scale penalty.
+* A note repeated with another duration is still a repeat.
+**/
+inline int pairScore(Note note1, Note note2) {
+	return fitness_tables->pairs.scores[pairIndex(note1, note2)];
+}
+
+/**
+* Score (in tenths) contributed by the first and last notes of a melody in the fitness of the run.
+**/
+inline int endpointScore(Note first, Note last) {
+	return fitness_tables->endpoints[notePitchClass(first) * PITCH_CLASSES + notePitchClass(last)];
+}
+
+/**
+* A fitness function scoring (in tenths) a melody given as an array of notes.
+**/
+typedef int (*FitnessFunction)(const Note* notes, size_t length);
+
+/**
+* Calculates melody fitness in tenths of a point. See fitness(); the rules are the terms of
+* DefaultFitness in FitnessTerms.h.
+**/
+int fitnessScore(const Note* notes, size_t length);
+
+inline int fitnessScore(const Melody& melody) {
+	return fitnessScore(melody.notes.data(), melody.size());
+}
+
+/**
+* Calculates melody fitness. The parents for the next generation would be chosen based on their fitness,
+* with higher fitness melodies having a higher chance of being selected.
+* This function awards points for consonant intervals (unison, perfect fourth, perfect fifth),
+* starting and ending on the tonic ('C'), and subtracts points for repeated notes to encourage diversity and adherence to tone
+* reference: https://www.researchgate.net/publication/287009971_A_fitness_function_for_computer-generated_music_using_genetic_algorithms
+**/
+inline double fitness(const Melody& melody) {
+	return fitnessScore(melody) / (double)SCORE_SCALE;
+}
+
+/**
+* Cached fitness of one melody together with the per-note contributions needed to
+* re-score it in O(1) after a single note changes. Scores in the fitness of the run, so a
+* state must be initialized again after setMelodyKey().
+**/
+struct FitnessState {
+	int score;							// total score, in tenths
+	std::vector<int> pair_scores;		// pair_scores[i] is the contribution of notes i and i + 1
+	int pitch_class_counts[PITCH_CLASSES];	// notes per pitch class, over all notes but the last
+	int unique_count;					// pitch classes with a non zero count
+
+	FitnessState() : score(0), unique_count(0) {}
+
+	double value() const { return score / (double)SCORE_SCALE; }
+};
+
+/**
+* Fully evaluates a melody and records its per-note contributions in state.
+**/
+void initFitnessState(FitnessState& state, const Melody& melody);
+
+/**
+* Returns the score (in tenths) the melody would have if the note at position was
+* replaced by new_note. Only the two intervals touching the position, the endpoint
+* bonuses and the unique note count are re-scored. Neither state nor melody change.
+**/
+int rescoreNoteChange(const FitnessState& state, const Melody& melody, size_t position, Note new_note);
+
+/**
+* Replaces the note at position with new_note and updates state in O(1).
+**/
+void applyNoteChange(FitnessState& state, Melody& melody, size_t position, Note new_note);
+
+/**
+* Sets state to the state of a crossover child that has the notes [begin, end) of inner and the
+* other notes of outer, from the states of the two parents: the pairs within either part are
+* taken over and only the two pairs across begin and end are scored, so this costs a copy of
+* the state of one parent plus O(notes taken from the other).
+**/
+void crossoverFitnessState(const FitnessState& outer_state, const Melody& outer, const FitnessState& inner_state,
+	const Melody& inner, size_t begin, size_t end, FitnessState& state);
@@ -0,0 +1,95 @@
+// FitnessCache.cpp
+//
+// Bounded, lock-free memoization of melody fitness scores keyed by a 64-bit genome hash.
+
+#include "FitnessCache.h"
+
+// Scores are stored as the raw bits of a 32 bit integer
+static unsigned long long packScore(int score) {
+	return (unsigned long long)(unsigned int)score;
+}
+
+static int unpackScore(unsigned long long data) {
+	return (int)(unsigned int)data;
+}
+
+FitnessCache::FitnessCache(size_t capacity, FitnessFunction function)
+	: slots(), mask(0), score_function(function ? function : static_cast<FitnessFunction>(&fitnessScore)), hit_count(0), miss_count(0) {
+	size_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+	std::vector<Slot> table(size);
+	slots.swap(table);
+	mask = size - 1;
+	clear();
+}
+
+bool FitnessCache::lookup(unsigned long long hash, int& score) const {
+	const Slot& slot = slots[hash & mask];
+	unsigned long long data = slot.data.load(std::memory_order_relaxed);
+	unsigned long long check = slot.check.load(std::memory_order_relaxed);
+	if ((check ^ data) != hash)
+		return false;
+	score = unpackScore(data);
+	return true;
+}
+
+void FitnessCache::store(unsigned long long hash, int score) {
+	Slot& slot = slots[hash & mask];
+	unsigned long long data = packScore(score);
+	slot.data.store(data, std::memory_order_relaxed);
+	slot.check.store(hash ^ data, std::memory_order_relaxed);
+}
+
+int FitnessCache::score(const Melody& melody) {
+	unsigned long long hash = melodyHash(melody);
+	int result;
+	if (lookup(hash, result)) {
+		hit_count.fetch_add(1, std::memory_order_relaxed);
+		return result;
+	}
+	miss_count.fetch_add(1, std::memory_order_relaxed);
+	result = score_function(melody.notes.data(), melody.size());
+	store(hash, result);
+	return result;
+}
+
+double FitnessCache::fitness(const Melody& melody) {
+	return score(melody) / (double)SCORE_SCALE;
+}
+
+void FitnessCache::setFitnessFunction(FitnessFunction function) {
+	score_function = function ? function : static_cast<FitnessFunction>(&fitnessScore);
+	clear();
+}
+
+void FitnessCache::clear() {
+	// An all zero slot would match the hash 0, so empty slots get a check word that cannot match
+	for (size_t i = 0; i < slots.size(); ++i) {
+		slots[i].data.store(0, std::memory_order_relaxed);
+		slots[i].check.store(~(unsigned long long)i, std::memory_order_relaxed);
+	}
+	hit_count.store(0, std::memory_order_relaxed);
+	miss_count.store(0, std::memory_order_relaxed);
+}
+
+void FitnessCache::saveSlots(unsigned long long* words) const {
+	for (size_t i = 0; i < slots.size(); ++i) {
+		words[2 * i] = slots[i].check.load(std::memory_order_relaxed);
+		words[2 * i + 1] = slots[i].data.load(std::memory_order_relaxed);
+	}
+}
+
+void FitnessCache::loadSlots(const unsigned long long* words, unsigned long long hits, unsigned long long misses) {
+	for (size_t i = 0; i < slots.size(); ++i) {
+		slots[i].check.store(words[2 * i], std::memory_order_relaxed);
+		slots[i].data.store(words[2 * i + 1], std::memory_order_relaxed);
+	}
+	hit_count.store(hits, std::memory_order_relaxed);
+	miss_count.store(misses, std::memory_order_relaxed);
+}
+
+double FitnessCache::hitRate() const {
+	unsigned long long total = hits() + misses();
+	return total == 0 ? 0.0 : hits() / (double)total;
+}
@@ -0,0 +1,85 @@
+// FitnessCache.h
+//
+// Bounded, lock-free memoization of melody fitness scores keyed by a 64-bit genome hash.
+//
+// The cache is a fixed size, direct mapped table. Each slot holds the score and a check word
+// (hash XOR score), both written with plain atomic stores. A reader only accepts a slot when
+// the check word matches the hash it is looking for, so a slot torn by two concurrent writers
+// is simply treated as a miss. Colliding melodies overwrite each other, which keeps the memory
+// use bounded no matter how long the run is.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include "Fitness.h"
+
+class FitnessCache {
+public:
+	/**
+	* Creates a cache with at least the given number of slots (rounded up to a power of two).
+	* Melodies are scored with fitnessScore() unless another fitness function is given.
+	**/
+	explicit FitnessCache(size_t capacity = 1 << 16, FitnessFunction function = NULL);
+
+	/**
+	* Changes the fitness function. Clears the cache, as the cached scores no longer apply.
+	**/
+	void setFitnessFunction(FitnessFunction function);
+
+	/**
+	* Looks up a score (in tenths) by genome hash. Returns false on a miss.
+	**/
+	bool lookup(unsigned long long hash, int& score) const;
+
+	/**
+	* Stores a score (in tenths) for a genome hash, replacing whatever used that slot.
+	**/
+	void store(unsigned long long hash, int score);
+
+	/**
+	* Returns the fitness score (in tenths) of a melody, evaluating it only on a cache miss.
+	**/
+	int score(const Melody& melody);
+
+	/**
+	* Returns the fitness of a melody, evaluating it only on a cache miss.
+	**/
+	double fitness(const Melody& melody);
+
+	/**
+	* Empties the cache and resets the counters.
+	**/
+	void clear();
+
+	/**
+	* Copies the slots into words, two per slot (check word, then score), e.g. for a checkpoint.
+	* words must have room for 2 * capacity() values.
+	**/
+	void saveSlots(unsigned long long* words) const;
+
+	/**
+	* Restores the slots saved by saveSlots() of a cache with the same capacity, and the counters.
+	**/
+	void loadSlots(const unsigned long long* words, unsigned long long hits, unsigned long long misses);
+
+	size_t capacity() const { return slots.size(); }
+	unsigned long long hits() const { return hit_count.load(std::memory_order_relaxed); }
+	unsigned long long misses() const { return miss_count.load(std::memory_order_relaxed); }
+	double hitRate() const;
+
+private:
+	struct Slot {
+		std::atomic<unsigned long long> check;	// hash ^ data
+		std::atomic<unsigned long long> data;	// the score
+	};
+
+	FitnessCache(const FitnessCache&);				// not copyable
+	FitnessCache& operator=(const FitnessCache&);
+
+	std::vector<Slot> slots;
+	size_t mask;
+	FitnessFunction score_function;
+	std::atomic<unsigned long long> hit_count;
+	std::atomic<unsigned long long> miss_count;
+};
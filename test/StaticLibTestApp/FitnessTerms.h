@@ -0,0 +1,239 @@
+// FitnessTerms.h
+//
+// Fitness functions composed at compile time from small policy types, the fitness terms.
+//
+// A term scores pairs of adjacent notes (pair()) and/or the melody as a whole (melody(), from
+// its first and last notes and the pitch classes it uses), and inherits a zero score from
+// FitnessTerm for whatever it does not look at. FitnessComposition<Terms...> sums the terms in a
+// single pass over the notes. Everything is inlined, so the terms fuse into one loop, and a term
+// that is left out of a composition costs nothing. The score() of a composition is an ordinary
+// FitnessFunction, so a new term or composition needs no change to the GA loop or the cache:
+//
+//   typedef FitnessComposition<IntervalReward, TonicEndpoints<7>, PitchClassVariety> MyFitness;
+//   fitness_cache.setFitnessFunction(&MyFitness::score);
+//
+// TabulatedPairs<Terms...> scores like FitnessComposition<Terms...>, but looks the pair scores up
+// in a table generated at compile time, one load per pair however many pair terms it folds.
+// ObjectiveComposition<Terms...> scores every term on its own in the same single pass, as the
+// objectives of multi-objective optimization (see MultiObjective.h). ScoreTables<Fitness> holds
+// a composition as FitnessTables, for delta re-scoring and the batch kernel.
+
+#pragma once
+
+#include "Fitness.h"
+
+/**
+* What the melody() of a term is given: the melody besides its pairs of adjacent notes.
+**/
+struct MelodySummary {
+	Note first;
+	Note last;
+	unsigned int pitch_classes;		// bit set of the pitch classes of every note but the last
+	size_t length;
+};
+
+/**
+* Base of the fitness terms: a term that scores nothing.
+**/
+struct FitnessTerm {
+	static constexpr int pair(Note, Note) { return 0; }
+	static constexpr int melody(const MelodySummary&) { return 0; }
+};
+
+/**
+* A fitness function made of the sum of its terms, in tenths.
+**/
+template <typename... Terms>
+struct FitnessComposition;
+
+template <>
+struct FitnessComposition<> : FitnessTerm {
+	static int score(const Note*, size_t) { return 0; }
+};
+
+template <typename Term, typename... Rest>
+struct FitnessComposition<Term, Rest...> {
+	static constexpr int pair(Note from, Note to) {
+		return Term::pair(from, to) + FitnessComposition<Rest...>::pair(from, to);
+	}
+
+	static constexpr int melody(const MelodySummary& summary) {
+		return Term::melody(summary) + FitnessComposition<Rest...>::melody(summary);
+	}
+
+	static int score(const Note* notes, size_t length) {
+		if (length == 0)
+			return 0;
+		int score = 0;
+		unsigned int pitch_classes = 0;
+		for (size_t i = 0; i + 1 < length; ++i) {
+			score += pair(notes[i], notes[i + 1]);
+			pitch_classes |= 1u << notePitchClass(notes[i]);
+		}
+		const MelodySummary summary = { notes[0], notes[length - 1], pitch_classes, length };
+		return score + melody(summary);
+	}
+};
+
+/**
+* Scores every term of a melody separately, into objectives[0 .. sizeof...(Terms)).
+**/
+typedef void (*ObjectiveFunction)(const Note* notes, size_t length, int* objectives);
+
+template <typename... Terms>
+struct ObjectiveComposition {
+	static const int count = sizeof...(Terms);
+
+	static void score(const Note* notes, size_t length, int* objectives) {
+		int scores[sizeof...(Terms)] = {};
+		if (length == 0) {
+			copyScores(scores, objectives);
+			return;
+		}
+		unsigned int pitch_classes = 0;
+		for (size_t i = 0; i + 1 < length; ++i) {
+			int term = 0;
+			// the expansion runs the terms in order, each into its own score
+			int expand[] = { (scores[term++] += Terms::pair(notes[i], notes[i + 1]), 0)... };
+			(void)expand;
+			pitch_classes |= 1u << notePitchClass(notes[i]);
+		}
+		const MelodySummary summary = { notes[0], notes[length - 1], pitch_classes, length };
+		int term = 0;
+		int expand[] = { (scores[term++] += Terms::melody(summary), 0)... };
+		(void)expand;
+		copyScores(scores, objectives);
+	}
+
+private:
+	static void copyScores(const int* scores, int* objectives) {
+		for (int term = 0; term < count; ++term)
+			objectives[term] = scores[term];
+	}
+};
+
+/******************** The terms of the default fitness function ***************************/
+
+/**
+* Rewards consonant intervals and stepwise motion between adjacent notes, penalizes leaps.
+**/
+struct IntervalReward : FitnessTerm {
+	static constexpr int pair(Note from, Note to) {
+		return intervalScore(calculateInterval(from, to));
+	}
+};
+
+/**
+* The consonance part of IntervalReward: consonant intervals, and the leap penalty.
+**/
+struct ConsonanceReward : FitnessTerm {
+	static constexpr int pair(Note from, Note to) {
+		return consonanceScore(calculateInterval(from, to));
+	}
+};
+
+/**
+* The stepwise motion part of IntervalReward.
+**/
+struct StepwiseMotion : FitnessTerm {
+	static constexpr int pair(Note from, Note to) {
+		return stepScore(calculateInterval(from, to));
+	}
+};
+
+/**
+* Penalizes a repeated pitch.
+**/
+struct RepeatPenalty : FitnessTerm {
+	static constexpr int pair(Note from, Note to) {
+		return calculateInterval(from, to) == 0 ? -REPEAT_PENALTY : 0;
+	}
+};
+
+/**
+* Rewards starting and ending on the tonic.
+**/
+template <int Tonic>
+struct TonicEndpoints : FitnessTerm {
+	static constexpr int melody(const MelodySummary& summary) {
+		return (notePitchClass(summary.first) == Tonic ? 10 : 0) + (notePitchClass(summary.last) == Tonic ? 10 : 0);
+	}
+};
+
+/**
+* Rewards every distinct pitch class used.
+**/
+struct PitchClassVariety : FitnessTerm {
+	static constexpr int melody(const MelodySummary& summary) {
+		return varietyScore(countPitchClasses(summary.pitch_classes));
+	}
+};
+
+/**
+* fitnessScore(): the rules of the original fitness function, in C major.
+**/
+typedef FitnessComposition<IntervalReward, RepeatPenalty, TonicEndpoints<0>, PitchClassVariety> DefaultFitness;
+
+/******************** Tabulated pair scores ***************************/
+
+/**
+* The pair scores of a term (or composition) for every pitch class pair and octave difference.
+* The pair scores must only depend on those, and fit into a signed char.
+**/
+template <typename Term>
+constexpr PairScoreMatrix tabulatePairs() {
+	PairScoreMatrix matrix = {};
+	for (int delta = -2; delta <= 2; ++delta)
+		for (int from = 0; from < PITCH_CLASSES; ++from)
+			for (int to = 0; to < PITCH_CLASSES; ++to)
+				matrix.scores[((delta + 2) * PITCH_CLASSES + from) * PITCH_CLASSES + to] =
+					(signed char)Term::pair(makeNote(from, DEFAULT_OCTAVE), makeNote(to, DEFAULT_OCTAVE + delta));
+	return matrix;
+}
+
+template <typename... Terms>
+struct PairTable {
+	static constexpr PairScoreMatrix pairs = tabulatePairs<FitnessComposition<Terms...>>();
+};
+
+template <typename... Terms>
+constexpr PairScoreMatrix PairTable<Terms...>::pairs;
+
+/**
+* The terms, with their pair scores looked up from a table generated at compile time.
+**/
+template <typename... Terms>
+struct TabulatedPairs {
+	static constexpr int pair(Note from, Note to) {
+		return PairTable<Terms...>::pairs.scores[pairIndex(from, to)];
+	}
+
+	static constexpr int melody(const MelodySummary& summary) {
+		return FitnessComposition<Terms...>::melody(summary);
+	}
+};
+
+/**
+* The tables of a fitness composition. Its melody terms must only look at the pitch classes of
+* the first and last notes, and at the pitch class set through PitchClassVariety, which scores
+* nothing for the empty set the endpoints are tabulated with.
+**/
+template <typename Fitness>
+constexpr FitnessTables tabulateFitness() {
+	FitnessTables tables = {};
+	tables.pairs = tabulatePairs<Fitness>();
+	for (int first = 0; first < PITCH_CLASSES; ++first)
+		for (int last = 0; last < PITCH_CLASSES; ++last) {
+			const MelodySummary summary = { makeNote(first), makeNote(last), 0, 2 };
+			tables.endpoints[first * PITCH_CLASSES + last] = (signed char)Fitness::melody(summary);
+		}
+	return tables;
+}
+
+template <typename Fitness>
+struct ScoreTables {
+	static constexpr FitnessTables tables = tabulateFitness<Fitness>();
+};
+
+template <typename Fitness>
+constexpr FitnessTables ScoreTables<Fitness>::tables;
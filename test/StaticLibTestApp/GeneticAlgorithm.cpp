@@ -0,0 +1,510 @@
+// GeneticAlgorithm.cpp
+//
+// The genetic algorithm operators (generation, mutation, crossover) and the generation
+// step shared by the interactive loop in SampleApp.cpp and the island model.
+
+#include "GeneticAlgorithm.h"
+#include "Evaluation.h"
+#include "ThreadPool.h"
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+Key melody_key;
+
+int scale_pitch_classes[PITCH_CLASSES] = { 0, 2, 4, 5, 7, 9, 11 };
+int scale_size = 7;
+
+FitnessCache fitness_cache;
+
+void setMelodyKey(const Key& key) {
+	melody_key = key;
+	unsigned int pitch_classes = keyPitchClasses(key);
+	scale_size = 0;
+	for (int pc = 0; pc < PITCH_CLASSES; ++pc)
+		if (pitch_classes & (1u << pc))
+			scale_pitch_classes[scale_size++] = pc;
+	fitness_cache.setFitnessFunction(keyFitnessFunction(key));
+	fitness_tables = keyFitnessTables(key);
+}
+
+/**
+* Maps 16 random bits onto [0, count) (multiply-shift).
+**/
+static inline int randomIndex(unsigned int bits16, int count) {
+	return (int)((bits16 * (unsigned int)count) >> 16);
+}
+
+// GENETIC ALGORITHM FUNCTIONS
+Melody generateNotes(int length, RandomStream& rng) {
+	Melody generatedNotes(length);
+	unsigned int random_words[64];
+
+	// two random words per note: the pitch class, then the octave and the duration
+	for (int i = 0; i < length; i++) {
+		if (i % 32 == 0)
+			rng.fill(random_words, 64);
+		const unsigned int pitch_word = random_words[2 * (i % 32)];
+		const unsigned int shape_word = random_words[2 * (i % 32) + 1];
+		// multiply-shift maps a random word onto [0, scale_size)
+		int index = (int)(((unsigned long long)pitch_word * scale_size) >> 32);
+		int octave = DEFAULT_OCTAVE - OCTAVE_SPREAD + randomIndex(shape_word & 0xFFFF, 2 * OCTAVE_SPREAD + 1);
+		int duration = randomIndex(shape_word >> 16, SHORTEST_DURATION + 1);
+		generatedNotes[i] = makeNote(scale_pitch_classes[index], octave, duration);
+	}
+
+	return generatedNotes;
+}
+
+/**
+* The note a mutation turns note into: a new pitch class of the scale, the note an octave up or
+* down, or a new duration (see mutate()).
+**/
+static Note mutatedNote(Note note, RandomStream& rng) {
+	const unsigned int word = rng.next();
+	switch (word & 3) {
+	case 2: {
+		int octave = noteOctave(note) + ((word & 4) ? 1 : -1);
+		octave = octave < 0 ? 1 : (octave > MAX_OCTAVE ? MAX_OCTAVE - 1 : octave);
+		return makeNote(notePitchClass(note), octave, noteDuration(note));
+	}
+	case 3:
+		return makeNote(notePitchClass(note), noteOctave(note), randomIndex(word >> 16, SHORTEST_DURATION + 1));
+	default:
+		return withPitchClass(note, scale_pitch_classes[randomIndex(word >> 16, scale_size)]);
+	}
+}
+
+void mutate(Melody& melody, RandomStream& rng) {
+	// Randomly select a position in the melody
+	int position = rng.below((unsigned int)melody.size());
+
+	// Apply the mutation
+	melody[position] = mutatedNote(melody[position], rng);
+}
+
+void mutate(Melody& melody, FitnessState& state, RandomStream& rng) {
+	int position = rng.below((unsigned int)melody.size());
+	applyNoteChange(state, melody, position, mutatedNote(melody[position], rng));
+}
+
+/**
+* Draws the crossover points of melodies of the given length: the notes [begin, end) are
+* swapped between the children. Not for uniform crossover.
+**/
+static void crossoverPoints(size_t length, RandomStream& rng, CrossoverMethod method, size_t& begin, size_t& end) {
+	begin = rng.below((unsigned int)length);
+	end = length;
+	if (method == CROSSOVER_TWO_POINT) {
+		end = rng.below((unsigned int)length + 1);
+		if (end < begin)
+			std::swap(begin, end);
+	}
+}
+
+/**
+* Uniform crossover: one random bit per note picks the parent each child takes it from (branch free).
+**/
+static void uniformCrossover(const Note* notes1, const Note* notes2, Note* out1, Note* out2, size_t length,
+	RandomStream& rng) {
+	for (size_t block = 0; block < length; block += 32) {
+		unsigned int bits = rng.next();
+		size_t block_end = std::min(length, block + 32);
+		for (size_t i = block; i < block_end; i++, bits >>= 1) {
+			Note swap = (Note)(0 - (bits & 1));		// all ones when the notes are swapped
+			Note difference = (Note)((notes1[i] ^ notes2[i]) & swap);
+			out1[i] = (Note)(notes1[i] ^ difference);
+			out2[i] = (Note)(notes2[i] ^ difference);
+		}
+	}
+}
+
+/**
+* Creates the children by swapping the notes [begin, end) of the parents.
+**/
+static void swapSegment(const Note* notes1, const Note* notes2, Melody& child1, Melody& child2, size_t begin,
+	size_t end) {
+	const size_t length = child1.size();
+	std::copy(notes1, notes1 + begin, child1.notes.begin());
+	std::copy(notes2 + begin, notes2 + end, child1.notes.begin() + begin);
+	std::copy(notes1 + end, notes1 + length, child1.notes.begin() + end);
+	std::copy(notes2, notes2 + begin, child2.notes.begin());
+	std::copy(notes1 + begin, notes1 + end, child2.notes.begin() + begin);
+	std::copy(notes2 + end, notes2 + length, child2.notes.begin() + end);
+}
+
+void crossover(const Melody& parent1, const Melody& parent2, Melody& child1, Melody& child2, RandomStream& rng,
+	CrossoverMethod method) {
+	// Make sure parents are the same size
+	//assert(parent1.size() == parent2.size());
+	const size_t length = parent1.size();
+	child1.notes.resize(length);
+	child2.notes.resize(length);
+	if (length == 0)
+		return;
+
+	if (method == CROSSOVER_UNIFORM) {
+		uniformCrossover(&parent1.notes[0], &parent2.notes[0], &child1.notes[0], &child2.notes[0], length, rng);
+		return;
+	}
+
+	// Randomly select a crossover point, or two, and swap the subsequences between them
+	size_t begin, end;
+	crossoverPoints(length, rng, method, begin, end);
+	swapSegment(&parent1.notes[0], &parent2.notes[0], child1, child2, begin, end);
+}
+
+void crossover(const Melody& parent1, const FitnessState& state1, const Melody& parent2, const FitnessState& state2,
+	Melody& child1, FitnessState& child_state1, Melody& child2, FitnessState* child_state2, RandomStream& rng,
+	CrossoverMethod method) {
+	const size_t length = parent1.size();
+	if (length == 0 || method == CROSSOVER_UNIFORM) {
+		// every note may come from either parent, so the children are scored in full
+		crossover(parent1, parent2, child1, child2, rng, method);
+		initFitnessState(child_state1, child1);
+		if (child_state2)
+			initFitnessState(*child_state2, child2);
+		return;
+	}
+
+	child1.notes.resize(length);
+	child2.notes.resize(length);
+	size_t begin, end;
+	crossoverPoints(length, rng, method, begin, end);
+	swapSegment(&parent1.notes[0], &parent2.notes[0], child1, child2, begin, end);
+	crossoverFitnessState(state1, parent1, state2, parent2, begin, end, child_state1);
+	if (child_state2)
+		crossoverFitnessState(state2, parent2, state1, parent1, begin, end, *child_state2);
+}
+
+/**
+* Runs task over [0, count) on the pool, or on the calling thread without one.
+**/
+template <typename Task>
+static void forRange(ThreadPool* pool, size_t count, const Task& task) {
+	if (pool)
+		pool->parallelFor(count, 0, task);
+	else
+		task(0, count);
+}
+
+static void scoreAll(ThreadPool* pool, const std::vector<Melody>& melodies, std::vector<int>& scores) {
+	if (pool) {
+		evaluatePopulation(*pool, fitness_cache, melodies, scores);
+		return;
+	}
+	scores.resize(melodies.size());
+	for (size_t i = 0; i < melodies.size(); ++i)
+		scores[i] = fitness_cache.score(melodies[i]);
+}
+
+/**
+* Scores melodies of equal length with the batch kernel, through the column-wise storage.
+**/
+static void batchScoreAll(ThreadPool* pool, const std::vector<Melody>& melodies, PopulationColumns& columns,
+	std::vector<int>& scores) {
+	columns.resize(melodies.size(), melodies.empty() ? 0 : melodies[0].size());
+	forRange(pool, melodies.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			columns.setMelody(i, melodies[i]);
+	});
+	if (pool)
+		evaluatePopulation(*pool, columns, scores);
+	else {
+		scores.resize(melodies.size());
+		batchFitness(columns, 0, columns.count, scores.data());
+	}
+}
+
+static inline bool useBatchFitness(const std::vector<Melody>& melodies) {
+	return melodies.size() >= BATCH_FITNESS_POPULATION;
+}
+
+/**
+* The context term of the fitness of a melody in the population.
+**/
+static inline int contextScore(const Population& population, const Melody& melody) {
+	if (population.context_fitness && !melody.empty())
+		return population.context_fitness(&melody.notes[0], melody.size(), population.fitness_context);
+	return 0;
+}
+
+/**
+* Initializes the fitness states of the individuals, unless they are up to date.
+**/
+static void prepareStates(Population& population, ThreadPool* pool) {
+	if (population.states_valid)
+		return;
+	population.states.resize(population.individuals.size());
+	forRange(pool, population.individuals.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			initFitnessState(population.states[i], population.individuals[i]);
+	});
+	population.states_valid = true;
+}
+
+void initPopulation(Population& population, int size, int length, unsigned long long seed, ThreadPool* pool) {
+	population.individuals.resize(size);
+	// the buffers the generations are bred into get their storage once, here
+	population.next_individuals.assign(size, Melody(length));
+	population.spare_children.assign(size, Melody(length));
+	forRange(pool, size, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			RandomStream rng(seed, individualStream(0, i));
+			population.individuals[i] = generateNotes(length, rng);
+		}
+	});
+	evaluate(population, pool);
+	selectParents(population);
+}
+
+void restartPopulation(Population& population, unsigned long long seed, unsigned long long generation, ThreadPool* pool) {
+	const size_t size = population.individuals.size();
+	const int length = (int)population.parent1().size();
+	population.individuals[0] = population.parent1();
+	// the children of a generation draw from its streams 0 .. size - 1
+	forRange(pool, size - 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin + 1; i < end + 1; i++) {
+			RandomStream rng(seed, individualStream(generation, size + i));
+			population.individuals[i] = generateNotes(length, rng);
+		}
+	});
+	evaluate(population, pool);
+	selectParents(population);
+}
+
+void evaluate(Population& population, ThreadPool* pool) {
+	// called when the individuals were replaced
+	population.states_valid = false;
+	if (useBatchFitness(population.individuals))
+		batchScoreAll(pool, population.individuals, population.columns, population.scores);
+	else
+		scoreAll(pool, population.individuals, population.scores);
+	if (population.context_fitness) {
+		forRange(pool, population.individuals.size(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				population.scores[i] += contextScore(population, population.individuals[i]);
+		});
+	}
+}
+
+void selectParents(Population& population) {
+	selectTopK(population.scores, 2, population.order);
+	if (population.order.empty())
+		return;
+	size_t best = population.order[0];
+	size_t second_best = population.order.size() > 1 ? population.order[1] : best;
+
+	population.parent1_index = best;
+	population.parent1_score = population.scores[best];
+	population.parent2_index = second_best;
+	population.parent2_score = population.scores[second_best];
+}
+
+/**
+* Telemetry of one generation: the stage times, the cache hit rate and the population statistics.
+* Does nothing (not even reading the clock) without telemetry.
+**/
+class GenerationProbe {
+public:
+	GenerationProbe(Telemetry* telemetry, unsigned long long generation) : telemetry(telemetry), hits(0), misses(0) {
+		if (!telemetry)
+			return;
+		record.generation = generation;
+		hits = fitness_cache.hits();
+		misses = fitness_cache.misses();
+		last = std::chrono::steady_clock::now();
+	}
+
+	void breedDone() {
+		if (telemetry)
+			record.breed_ms = lap();
+	}
+
+	void evaluateDone() {
+		if (telemetry)
+			record.evaluate_ms = lap();
+	}
+
+	// Called after selection, sends the record
+	void finish(const Population& population) {
+		if (!telemetry)
+			return;
+		record.select_ms = lap();
+		unsigned long long lookups = fitness_cache.hits() - hits + fitness_cache.misses() - misses;
+		record.cache_hit_rate = lookups ? (fitness_cache.hits() - hits) / (double)lookups : 0;
+		describePopulation(population.individuals, population.scores, record);
+		telemetry->record(record);
+	}
+
+private:
+	// Milliseconds since the previous lap
+	double lap() {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(now - last).count();
+		last = now;
+		return ms;
+	}
+
+	Telemetry* telemetry;
+	GenerationRecord record;
+	std::chrono::steady_clock::time_point last;
+	unsigned long long hits, misses;
+};
+
+void evolveGeneration(Population& population, unsigned long long seed, unsigned long long generation, ThreadPool* pool,
+	Telemetry* telemetry) {
+	const size_t size = population.individuals.size();
+
+	GenerationProbe probe(telemetry, generation);
+
+	const bool best_two = population.selection.method == SELECTION_BEST_TWO;
+	if (!best_two)
+		population.parent_selection.prepare(population.selection, population.scores);
+
+	// Large populations score all children with the batch kernel after breeding, the others
+	// derive the states of the children from the states of their parents
+	const bool batch = useBatchFitness(population.individuals);
+	if (!batch) {
+		prepareStates(population, pool);
+		population.next_states.resize(size);
+		population.spare_states.resize(size);
+	}
+
+	// Generate new population. Every slot draws from its own random stream,
+	// so the children are the same no matter which thread makes them.
+	// The children are bred into the next generation's buffer while the parents stay in place.
+	std::vector<Melody>& next = population.next_individuals;
+	next.resize(size);
+	population.spare_children.resize(size);
+	forRange(pool, size, [&](size_t begin, size_t end) {
+		for (size_t j = begin; j < end; j++) {
+			RandomStream rng(seed, individualStream(generation, j));
+			size_t parent1 = population.parent1_index;
+			size_t parent2 = population.parent2_index;
+			if (!best_two) {
+				parent1 = population.parent_selection.select(rng);
+				parent2 = population.parent_selection.select(rng);
+			}
+			// Create new melody by crossover
+			// Perform crossover to generate children, straight into the child slots
+			Melody& child1 = next[j];
+			Melody& child2 = population.spare_children[j];
+			if (batch) {
+				crossover(population.individuals[parent1], population.individuals[parent2], child1, child2, rng,
+					population.crossover);
+				// Apply mutation
+				mutate(child1, rng);
+				mutate(child2, rng);
+			}
+			else {
+				FitnessState& state1 = population.next_states[j];
+				FitnessState& state2 = population.spare_states[j];
+				crossover(population.individuals[parent1], population.states[parent1], population.individuals[parent2],
+					population.states[parent2], child1, state1, child2, &state2, rng, population.crossover);
+				mutate(child1, state1, rng);
+				mutate(child2, state2, rng);
+			}
+		}
+	});
+	probe.breedDone();
+
+	// Score the children and keep the better one of every slot.
+	// selection has been implemented here as one of the crossover children has been eliminated.
+	if (batch) {
+		batchScoreAll(pool, next, population.columns, population.next_scores);
+		batchScoreAll(pool, population.spare_children, population.columns, population.spare_scores);
+	}
+	population.next_scores.resize(size);
+	forRange(pool, size, [&](size_t begin, size_t end) {
+		for (size_t j = begin; j < end; j++) {
+			int score1 = (batch ? population.next_scores[j] : population.next_states[j].score)
+				+ contextScore(population, next[j]);
+			int score2 = (batch ? population.spare_scores[j] : population.spare_states[j].score)
+				+ contextScore(population, population.spare_children[j]);
+			if (score1 > score2)
+				population.next_scores[j] = score1;
+			else {
+				// the second child wins ties; swapping only exchanges the storage of the melodies
+				std::swap(next[j], population.spare_children[j]);
+				if (!batch)
+					std::swap(population.next_states[j], population.spare_states[j]);
+				population.next_scores[j] = score2;
+			}
+		}
+	});
+	probe.evaluateDone();
+
+	// the new generation takes over, and the old one becomes the buffer of the next
+	population.individuals.swap(next);
+	population.scores.swap(population.next_scores);
+	if (batch)
+		population.states_valid = false;
+	else
+		population.states.swap(population.next_states);
+
+	// Select the two best parents for the next generation
+	selectParents(population);
+	probe.finish(population);
+}
+
+void steadyStateStep(Population& population, size_t replace_count, unsigned long long seed, unsigned long long step,
+	Telemetry* telemetry) {
+	const size_t size = population.individuals.size();
+	// the best two are kept
+	if (replace_count + 2 > size)
+		replace_count = size > 2 ? size - 2 : 0;
+	if (replace_count == 0)
+		return;
+
+	GenerationProbe probe(telemetry, step);
+
+	// the worst replace_count individuals, without sorting the rest
+	std::vector<size_t>& order = population.order;
+	selectBottomK(population.scores, replace_count, order);
+
+	const bool best_two = population.selection.method == SELECTION_BEST_TWO;
+	if (!best_two)
+		population.parent_selection.prepare(population.selection, population.scores);
+
+	// The children are bred into the next generation's buffer, so that every parent is read
+	// before any individual is replaced, and then swapped with the melodies they replace.
+	// Their states are derived from the states of their parents.
+	prepareStates(population, NULL);
+	std::vector<Melody>& next = population.next_individuals;
+	next.resize(size);
+	population.next_states.resize(size);
+	for (size_t c = 0; c < replace_count; c++) {
+		RandomStream rng(seed, individualStream(step, order[c]));
+		size_t parent1 = population.parent1_index;
+		size_t parent2 = population.parent2_index;
+		if (best_two) {
+			if (rng.next() & 1)
+				std::swap(parent1, parent2);
+		}
+		else {
+			parent1 = population.parent_selection.select(rng);
+			parent2 = population.parent_selection.select(rng);
+		}
+		Melody& child = next[c];
+		crossover(population.individuals[parent1], population.states[parent1], population.individuals[parent2],
+			population.states[parent2], child, population.next_states[c], population.spare_child, NULL, rng,
+			population.crossover);
+		mutate(child, population.next_states[c], rng);
+	}
+	for (size_t c = 0; c < replace_count; c++) {
+		std::swap(population.individuals[order[c]], next[c]);
+		std::swap(population.states[order[c]], population.next_states[c]);
+	}
+	probe.breedDone();
+
+	for (size_t c = 0; c < replace_count; c++)
+		population.scores[order[c]] = population.states[order[c]].score
+			+ contextScore(population, population.individuals[order[c]]);
+	probe.evaluateDone();
+
+	selectParents(population);
+	probe.finish(population);
+}
@@ -0,0 +1,205 @@
+// GeneticAlgorithm.h
+//
+// The genetic algorithm operators (generation, mutation, crossover) and the generation
+// step shared by the interactive loop in SampleApp.cpp and the island model.
+
+#pragma once
+
+#include <utility>
+#include <vector>
+#include "Melody.h"
+#include "BatchFitness.h"
+#include "Fitness.h"
+#include "FitnessCache.h"
+#include "KeyFitness.h"
+#include "Random.h"
+#include "Selection.h"
+
+class ThreadPool;
+class Telemetry;
+
+// Key the melodies are evolved in (C major by default, see setMelodyKey)
+extern Key melody_key;
+
+// Pitch classes of the scale of the key (C D E F G A B for C major) that melodies are generated from
+extern int scale_pitch_classes[PITCH_CLASSES];
+extern int scale_size;
+
+// Fitness scores shared by every call site, so an identical melody is only ever scored once
+extern FitnessCache fitness_cache;
+
+// Generated notes lie within this many octaves of DEFAULT_OCTAVE
+const int OCTAVE_SPREAD = 1;
+// Shortest note value generated and mutated into (whole notes down to sixteenths)
+const int SHORTEST_DURATION = DURATION_SIXTEENTH;
+
+// Populations of at least this many individuals are scored with the batch kernel (see
+// BatchFitness.h): their children are mostly new melodies, and the kernel scores them faster
+// than the cache misses. The children of smaller populations are scored by delta, from the
+// fitness states of their parents (see Population::states). All give the same scores.
+const size_t BATCH_FITNESS_POPULATION = 4096;
+
+/**
+* Helper function to switch the key melodies are generated, mutated and scored in.
+* Picks the fitness kernel specialized for the key, for the cache and, as tables, for the
+* delta re-scoring and the batch kernel.
+**/
+void setMelodyKey(const Key& key);
+
+/**
+Generate Random Melody of notes from the scale of the key, each in a random octave around the
+default one (see OCTAVE_SPREAD) and of a random duration (see SHORTEST_DURATION).
+Random numbers are drawn from the stream in bulk, a block of words at a time.
+**/
+Melody generateNotes(int length, RandomStream& rng);
+
+/**
+* randomly select a position within the melody and change
+* the note at that position: half of the mutations draw a new pitch class from the scale,
+* a quarter move the note one octave up or down (within 0 - 10) and a quarter draw a new
+* duration. The octave only moves a step at a time, so melodies stay near the octave they
+* were generated in (or moved to, see MultiTrack.h).
+*
+* examples of mutation algorithms:
+* https://www.geeksforgeeks.org/mutation-algorithms-for-string-manipulation-ga/
+**/
+void mutate(Melody& melody, RandomStream& rng);
+
+/**
+* Same as mutate(), but keeps the cached fitness state of the melody up to date.
+* Only the intervals around the mutated note are re-scored, so this is O(1)
+* regardless of the melody length.
+**/
+void mutate(Melody& melody, FitnessState& state, RandomStream& rng);
+
+enum CrossoverMethod {
+	CROSSOVER_ONE_POINT,		// the notes after a random point are swapped
+	CROSSOVER_TWO_POINT,		// the notes between two random points are swapped
+	CROSSOVER_UNIFORM			// every note is swapped with a probability of one half
+};
+
+/**
+* Two melodies are picked from the mating pool at random to
+* crossover in order to produce superior offspring.
+* reference: https://www.geeksforgeeks.org/crossover-in-genetic-algorithm/
+*
+* The children are written into child1 and child2, which must not be the parents. Their storage
+* is reused, so once they have the length of the parents no memory is allocated.
+**/
+void crossover(const Melody& parent1, const Melody& parent2, Melody& child1, Melody& child2, RandomStream& rng,
+	CrossoverMethod method = CROSSOVER_ONE_POINT);
+
+/**
+* Same as crossover(), making the same children, but also sets the fitness states of the
+* children from the states of the parents (see crossoverFitnessState()); child_state2 is NULL
+* when the second child is dropped. After uniform crossover the states of the children are
+* initialized in full.
+**/
+void crossover(const Melody& parent1, const FitnessState& state1, const Melody& parent2, const FitnessState& state2,
+	Melody& child1, FitnessState& child_state1, Melody& child2, FitnessState* child_state2, RandomStream& rng,
+	CrossoverMethod method = CROSSOVER_ONE_POINT);
+
+/**
+* A fitness term that depends on more than the melody itself, such as how a track of a
+* multi-track arrangement sounds with the other tracks (see Harmony.h). Returns a score in tenths.
+* It is not cached like the fitness of the melody, as its context changes during the run.
+**/
+typedef int (*ContextFitnessFunction)(const Note* notes, size_t length, const void* context);
+
+/**
+* A population evolved with two parents: every generation each population slot gets the
+* better of two mutated crossover children of the parents, and the best two individuals
+* become the parents of the next generation.
+* With another selection method every slot selects its own two parents from the population.
+*
+* The population is double buffered: a generation is bred from individuals into
+* next_individuals, and the two buffers swap roles at the end of it. The parents are indices
+* into individuals, so no melody is copied from one generation to the next and, once every
+* buffer holds melodies of the right length, a generation does not allocate.
+* Every individual has the same length, which the column-wise batch scoring relies on.
+**/
+struct Population {
+	std::vector<Melody> individuals;	// the current generation
+	std::vector<int> scores;			// fitness of each individual, in tenths
+
+	// the generation being bred, which replaces the current one when it is done
+	std::vector<Melody> next_individuals;
+	std::vector<int> next_scores;
+
+	// the other crossover child of each slot; the worse of the two children is left here
+	std::vector<Melody> spare_children;
+
+	size_t parent1_index, parent2_index;	// best and second best individual
+	int parent1_score, parent2_score;
+
+	SelectionOptions selection;			// how the parents of the children are chosen
+	CrossoverMethod crossover;
+	ParentSelection parent_selection;
+	std::vector<size_t> order;			// scratch list of individuals for selection, kept to reuse its storage
+	PopulationColumns columns;			// scratch of the batch fitness kernel, for large populations
+	std::vector<int> spare_scores;		// batch scores of spare_children
+	Melody spare_child;					// second crossover child of the steady-state GA, which is dropped
+
+	// added to the fitness of every individual when set, called with fitness_context
+	ContextFitnessFunction context_fitness;
+	const void* fitness_context;
+
+	// fitness state of every individual (see FitnessState): the children are scored by deriving
+	// their states from the states of their parents and the mutation. next_states and
+	// spare_states go with next_individuals and spare_children. Not kept by the batch scored
+	// generations of large populations; anything that replaces individuals otherwise clears
+	// states_valid, and the next generation rebuilds them.
+	std::vector<FitnessState> states;
+	std::vector<FitnessState> next_states;
+	std::vector<FitnessState> spare_states;
+	bool states_valid;
+
+	Population() : parent1_index(0), parent2_index(0), parent1_score(0), parent2_score(0),
+		crossover(CROSSOVER_ONE_POINT), context_fitness(NULL), fitness_context(NULL), states_valid(false) {}
+
+	const Melody& parent1() const { return individuals[parent1_index]; }
+	const Melody& parent2() const { return individuals[parent2_index]; }
+};
+
+/**
+* Fills the population with random melodies (drawn from the streams of generation 0),
+* scores them and selects the parents. With a NULL pool everything runs on the calling thread.
+**/
+void initPopulation(Population& population, int size, int length, unsigned long long seed, ThreadPool* pool);
+
+/**
+* Replaces a converged population with new random melodies, drawn from streams of the given
+* generation that no child uses, and keeps its best melody. Scores them and selects the parents.
+**/
+void restartPopulation(Population& population, unsigned long long seed, unsigned long long generation, ThreadPool* pool);
+
+/**
+* Scores the individuals of the population.
+**/
+void evaluate(Population& population, ThreadPool* pool);
+
+/**
+* Picks the best and second best individuals of the population as the parents (top-2 selection).
+**/
+void selectParents(Population& population);
+
+/**
+* Runs one generation: selection of the parents of every slot (see Population::selection),
+* their crossover and mutation, scoring and the selection of the best two.
+* Every population slot draws from its own random stream of the given generation, so the
+* result only depends on the seed, never on the threads.
+* With telemetry, the stage times and population statistics of the generation are recorded.
+**/
+void evolveGeneration(Population& population, unsigned long long seed, unsigned long long generation, ThreadPool* pool,
+	Telemetry* telemetry = NULL);
+
+/**
+* One step of the steady-state GA: the worst replace_count individuals are replaced by mutated
+* crossover children, whose parents are chosen as in evolveGeneration (see Population::selection),
+* and the best two are selected again.
+* The best two are never replaced, so replace_count is at most the population size less two.
+* The melodies swap storage with next_individuals, so after the first step nothing is allocated.
+* Every replaced slot draws from its own random stream of the step.
+**/
+void steadyStateStep(Population& population, size_t replace_count, unsigned long long seed, unsigned long long step,
+	Telemetry* telemetry = NULL);
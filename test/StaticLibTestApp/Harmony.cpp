@@ -0,0 +1,108 @@
+// Harmony.cpp
+//
+// Harmony fitness of multi-track arrangements: the vertical intervals between the notes that
+// tracks play at the same time.
+
+#include "Harmony.h"
+
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Score of each interval class: unison / octave, minor second / major seventh, major second /
+// minor seventh, minor third / major sixth, major third / minor sixth, fourth / fifth, tritone
+static const signed char INTERVAL_CLASS_SCORES[7] = { 4, -6, -3, 8, 8, 5, -4 };
+
+/**
+* Interval class of two pitch classes: their distance around the octave, 0 - 6 semitones.
+**/
+static inline int intervalClass(int pitch_class1, int pitch_class2) {
+	int distance = pitch_class1 > pitch_class2 ? pitch_class1 - pitch_class2 : pitch_class2 - pitch_class1;
+	return std::min(distance, PITCH_CLASSES - distance);
+}
+
+int verticalScore(Note lower, Note upper) {
+	return INTERVAL_CLASS_SCORES[intervalClass(notePitchClass(lower), notePitchClass(upper))];
+}
+
+int harmonyScore(const Note* lower, const Note* upper, size_t length) {
+	size_t i = 0;
+	int score = 0;
+#ifdef __AVX2__
+	const __m256i low_nibble = _mm256_set1_epi16(0x0F);
+	const __m256i twelve = _mm256_set1_epi8(PITCH_CLASSES);
+	const __m256i ones = _mm256_set1_epi8(1);
+	const __m256i ones16 = _mm256_set1_epi16(1);
+	// the shuffle looks up within each 128-bit lane, so both lanes hold the table
+	const __m256i table = _mm256_setr_epi8(4, -6, -3, 8, 8, 5, -4, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		4, -6, -3, 8, 8, 5, -4, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	__m256i sums = _mm256_setzero_si256();
+	for (; i + 32 <= length; i += 32) {
+		// the pitch classes of 32 steps packed into bytes; the packing interleaves the 128-bit
+		// lanes of the two loads, in the same order for both tracks, and the sum ignores the order
+		const __m256i* lower_notes = reinterpret_cast<const __m256i*>(lower + i);
+		const __m256i* upper_notes = reinterpret_cast<const __m256i*>(upper + i);
+		__m256i pc1 = _mm256_packus_epi16(_mm256_and_si256(_mm256_loadu_si256(lower_notes), low_nibble),
+			_mm256_and_si256(_mm256_loadu_si256(lower_notes + 1), low_nibble));
+		__m256i pc2 = _mm256_packus_epi16(_mm256_and_si256(_mm256_loadu_si256(upper_notes), low_nibble),
+			_mm256_and_si256(_mm256_loadu_si256(upper_notes + 1), low_nibble));
+		__m256i distance = _mm256_sub_epi8(_mm256_max_epu8(pc1, pc2), _mm256_min_epu8(pc1, pc2));
+		__m256i interval_class = _mm256_min_epu8(distance, _mm256_sub_epi8(twelve, distance));
+		__m256i scores = _mm256_shuffle_epi8(table, interval_class);
+		// widen the byte scores to 32 bits: pairs to 16 bits, then pairs of those
+		sums = _mm256_add_epi32(sums, _mm256_madd_epi16(_mm256_maddubs_epi16(ones, scores), ones16));
+	}
+	int lanes[8];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), sums);
+	for (int lane = 0; lane < 8; ++lane)
+		score += lanes[lane];
+#endif
+	for (; i < length; ++i)
+		score += verticalScore(lower[i], upper[i]);
+	return score;
+}
+
+int timedHarmonyScore(const Note* lower, size_t lower_length, const Note* upper, size_t upper_length) {
+	// the notes up to the first two of different durations start and end together
+	const size_t length = std::min(lower_length, upper_length);
+	size_t i = 0;
+	while (i < length && noteDuration(lower[i]) == noteDuration(upper[i]))
+		++i;
+	int score = harmonyScore(lower, upper, i);
+
+	// from there on, after each pair the note that ends first (or both) makes way for the next one
+	size_t j = i;
+	unsigned int lower_end = 0, upper_end = 0;	// end of the current notes, from the start of the walk
+	if (i < length) {
+		lower_end = noteLength(lower[i]);
+		upper_end = noteLength(upper[j]);
+	}
+	while (i < lower_length && j < upper_length) {
+		score += verticalScore(lower[i], upper[j]);
+		const unsigned int end = std::min(lower_end, upper_end);
+		if (lower_end == end && ++i < lower_length)
+			lower_end += noteLength(lower[i]);
+		if (upper_end == end && ++j < upper_length)
+			upper_end += noteLength(upper[j]);
+	}
+	return score;
+}
+
+int arrangementHarmony(const std::vector<Melody>& tracks) {
+	int score = 0;
+	for (size_t t = 0; t + 1 < tracks.size(); ++t)
+		if (!tracks[t].empty() && !tracks[t + 1].empty())
+			score += timedHarmonyScore(&tracks[t + 1].notes[0], tracks[t + 1].size(), &tracks[t].notes[0],
+				tracks[t].size());
+	return score;
+}
+
+bool harmonyUsesAVX2() {
+#ifdef __AVX2__
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,48 @@
+// Harmony.h
+//
+// Harmony fitness of multi-track arrangements: the vertical intervals between the notes that
+// tracks play at the same time.
+//
+// Only adjacent voices are compared (track t with track t + 1), so scoring an arrangement costs
+// tracks x length instead of growing with every pair of tracks. The interval of two notes is
+// folded into its interval class (0 - 6 semitones, octaves and inversions ignored) and scored
+// from a small table. When built with AVX2 the kernel packs the pitch classes of 32 notes
+// into bytes and scores them with a byte shuffle as the table lookup; the scalar loop gives the
+// same scores.
+//
+// The tracks evolve their own rhythms (mutation draws new durations), so the notes of two
+// tracks are paired in time, not by position: every pair of notes that sound together scores
+// once. While the two tracks keep the same rhythm their notes pair by position, and that part
+// is scored with the kernel.
+
+#pragma once
+
+#include <vector>
+#include "Melody.h"
+
+/**
+* Score (in tenths) of two notes sounding together, by their interval class:
+* thirds and sixths are the most consonant, seconds, sevenths and the tritone are penalized.
+**/
+int verticalScore(Note lower, Note upper);
+
+/**
+* Sum of the vertical scores of two equally long tracks, note by note.
+**/
+int harmonyScore(const Note* lower, const Note* upper, size_t length);
+
+/**
+* Harmony of two tracks of any rhythms: the vertical scores of every pair of notes that sound
+* together, for as long as both tracks play. Equals harmonyScore() for tracks of the same rhythm.
+**/
+int timedHarmonyScore(const Note* lower, size_t lower_length, const Note* upper, size_t upper_length);
+
+/**
+* Harmony of a whole arrangement: the timed harmony scores of every pair of adjacent tracks.
+**/
+int arrangementHarmony(const std::vector<Melody>& tracks);
+
+/**
+* True when harmonyScore() runs the AVX2 kernel.
+**/
+bool harmonyUsesAVX2();
@@ -0,0 +1,286 @@
+// HeadlessRun.cpp
+//
+// The parts of a GA run that need no MIDI device, and the headless runner.
+
+#include "HeadlessRun.h"
+#include "MidiEncoder.h"
+#include "ProcessIslands.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+bool setUpRun(RunSetup& run) {
+	RunOptions& options = run.options;
+	string error;
+
+	// continue a saved run, whose settings replace the ones of the command line
+	CheckpointState resumed;
+	if (!options.resume.empty()) {
+		if (!loadCheckpoint(options.resume, run.population, resumed, error)) {
+			fprintf(stderr, "%s\n", error.c_str());
+			return false;
+		}
+		if (resumed.convergence.stopped()) {
+			fprintf(stderr, "%s is of a run that stopped after generation %llu (%s), it cannot be resumed\n",
+				options.resume.c_str(), resumed.convergence.stop.generation,
+				convergenceReasonName(resumed.convergence.stop.reason));
+			return false;
+		}
+		options.seed = resumed.seed;
+		options.seed_given = true;
+		options.key = resumed.key;
+		options.steady_state = resumed.steady_state;
+		options.population_size = (int)run.population.individuals.size();
+		options.melody_length = (int)run.population.parent1().size();
+		options.selection = run.population.selection;
+		options.crossover = run.population.crossover;
+	}
+	run.first_generation = (int)resumed.generation;
+
+	// seed the current time for the random streams, the same seed reproduces the whole run
+	run.seed = options.seed_given ? options.seed : (unsigned long long)time(0);
+	if (options.resume.empty())
+		setMelodyKey(options.key); // evolve in C major unless --key says otherwise (a checkpoint sets its own)
+
+	// per generation telemetry, off unless --telemetry is given
+	if (!options.telemetry.empty()) {
+		if (!run.telemetry.open(options.telemetry)) {
+			fprintf(stderr, "Could not write %s\n", options.telemetry.c_str());
+			return false;
+		}
+		run.outputs.telemetry = &run.telemetry;
+	}
+
+	// checkpoints of the run, written in the background, off unless --checkpoint is given
+	if (!options.checkpoint.empty()) {
+		run.checkpoints.open(options.checkpoint);
+		run.outputs.checkpoints = &run.checkpoints;
+	}
+
+	// MIDI files of the best melodies, written in the background, off unless --export-midi is given
+	if (!options.export_midi.empty()) {
+		run.midi.open(options.export_midi, options.export_every);
+		run.outputs.midi = &run.midi;
+	}
+
+	// stops (or restarts) a run that no longer improves, off unless --converge is given
+	run.convergence = ConvergenceMonitor(options.convergence);
+	run.convergence.restore(resumed.convergence);
+	return true;
+}
+
+IslandOptions islandOptions(const RunOptions& run, unsigned long long seed) {
+	IslandOptions options;
+	options.islands = run.islands;
+	options.population_size = run.population_size;
+	options.melody_length = run.melody_length;
+	options.generations = run.generations;
+	options.migration_interval = run.migration_interval;
+	options.seed = seed;
+	options.selection = run.selection;
+	options.crossover = run.crossover;
+	return options;
+}
+
+MultiTrackOptions multiTrackOptions(const RunOptions& run, unsigned long long seed) {
+	MultiTrackOptions options;
+	options.tracks = run.tracks;
+	options.population_size = run.population_size;
+	options.melody_length = run.melody_length;
+	options.generations = run.generations;
+	options.seed = seed;
+	options.selection = run.selection;
+	options.crossover = run.crossover;
+	return options;
+}
+
+/**
+* Writes the distinct melodies of the Pareto front of a multi-objective run to a CSV file, one
+* per line with its objectives. count is set to the number of melodies written.
+**/
+static bool writeParetoFront(const string& file, const ParetoPopulation& pareto, size_t& count) {
+	vector<size_t> front;
+	paretoFront(pareto, front);
+	ofstream csv(file.c_str());
+	csv << "melody";
+	for (int j = 0; j < OBJECTIVES; ++j)
+		csv << "," << objectiveName(j);
+	csv << ",fitness\n";
+	set<string> written; // the front holds copies of the same melodies
+	for (size_t k = 0; k < front.size(); ++k) {
+		const string music = toMusicString(pareto.individuals[front[k]]);
+		if (!written.insert(music).second)
+			continue;
+		csv << music;
+		for (int j = 0; j < OBJECTIVES; ++j)
+			csv << "," << pareto.objectivesOf(front[k])[j] / (double)SCORE_SCALE;
+		csv << "," << objectiveSum(pareto, front[k]) / (double)SCORE_SCALE << "\n";
+	}
+	count = written.size();
+	csv.close();
+	return !!csv;
+}
+
+bool runGeneration(const RunOptions& options, unsigned long long seed, Population& population, int i,
+	ThreadPool& pool, const RunOutputs& outputs, ConvergenceMonitor& convergence) {
+	if (options.steady_state > 0)
+		steadyStateStep(population, options.steady_state, seed, i + 1, outputs.telemetry);
+	else
+		evolveGeneration(population, seed, i + 1, &pool, outputs.telemetry);
+	const bool converged = convergence.update(population, seed, i + 1, &pool);
+
+	if (outputs.checkpoints && ((i + 1) % options.checkpoint_interval == 0 || i + 1 == options.generations || converged)) {
+		CheckpointState state;
+		state.seed = seed;
+		state.generation = i + 1;
+		state.key = melody_key;
+		state.steady_state = options.steady_state;
+		convergence.save(state.convergence);
+		outputs.checkpoints->save(population, state);
+	}
+	if (outputs.midi)
+		outputs.midi->record(i + 1, population.parent1(), population.parent1_score);
+	return converged;
+}
+
+bool finishOutputs(const RunOptions& options, const RunOutputs& outputs) {
+	bool written = true;
+	if (outputs.checkpoints && !outputs.checkpoints->close()) {
+		fprintf(stderr, "Could not write %s\n", options.checkpoint.c_str());
+		written = false;
+	}
+	if (outputs.midi) {
+		if (!outputs.midi->close()) {
+			fprintf(stderr, "Could not write all of %s_*.mid\n", options.export_midi.c_str());
+			written = false;
+		}
+		if (outputs.midi->dropped())
+			fprintf(stderr, "MIDI export fell behind, %llu melodies were not exported\n", outputs.midi->dropped());
+	}
+	return written;
+}
+
+int runHeadless(RunSetup& run) {
+	const RunOptions& options = run.options;
+	const unsigned long long seed = run.seed;
+	Population& population = run.population;
+	const RunOutputs& outputs = run.outputs;
+	ConvergenceMonitor& convergence = run.convergence;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	Melody best;
+	int best_score = 0;
+	unsigned long long migrations = 0;
+	MultiTrackResult arrangement;
+	ParetoPopulation pareto;
+	size_t front_size = 0;
+
+	if (options.islands > 1) {
+		IslandOptions island_options = islandOptions(options, seed);
+		ProcessIslandResult result;
+		if (options.island_processes)
+			result = runProcessIslands(island_options, options.pin_cpus);
+		else
+			static_cast<IslandResult&>(result) = runIslands(island_options);
+		best = result.best;
+		best_score = result.best_score;
+		migrations = result.migrations;
+	}
+	else if (options.tracks > 1) {
+		arrangement = runMultiTrack(multiTrackOptions(options, seed));
+		best = arrangement.tracks[0];
+		best_score = arrangement.total_score;
+	}
+	else if (options.multi_objective) {
+		ThreadPool pool;
+		pareto.crossover = options.crossover;
+		initParetoPopulation(pareto, options.population_size, options.melody_length, seed, &pool);
+		for (int i = 0; i < options.generations; i++)
+			evolveParetoGeneration(pareto, seed, i + 1, &pool);
+		const size_t compromise = bestCompromise(pareto);
+		best = pareto.individuals[compromise];
+		best_score = objectiveSum(pareto, compromise);
+		const string front_file = options.output + "_front.csv";
+		if (!writeParetoFront(front_file, pareto, front_size)) {
+			fprintf(stderr, "Could not write %s\n", front_file.c_str());
+			return 1;
+		}
+	}
+	else {
+		ThreadPool pool;
+		if (population.individuals.empty()) {
+			population.selection = options.selection;
+			population.crossover = options.crossover;
+			initPopulation(population, options.population_size, options.melody_length, seed, &pool);
+		}
+		for (int i = run.first_generation; i < options.generations; i++)
+			if (runGeneration(options, seed, population, i, pool, outputs, convergence))
+				break;
+		best = population.parent1();
+		best_score = population.parent1_score;
+		if (!finishOutputs(options, outputs))
+			return 1;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	const string report_file = options.output + ".txt";
+	const string midi_file = options.output + ".mid";
+	ofstream report(report_file.c_str());
+	report << "seed " << seed << "\n"
+		<< "key " << keyName(melody_key) << "\n"
+		<< "population " << options.population_size << "\n"
+		<< "length " << options.melody_length << "\n"
+		<< "generations " << options.generations << "\n"
+		<< "islands " << options.islands << "\n"
+		<< "migrations " << migrations << "\n"
+		<< "best_fitness " << best_score / (double)SCORE_SCALE << "\n"
+		<< "best_melody " << best << "\n"
+		<< "seconds " << seconds << "\n"
+		<< "cache_hit_rate " << fitness_cache.hitRate() << "\n";
+	if (!arrangement.tracks.empty()) {
+		report << "tracks " << arrangement.tracks.size() << "\n"
+			<< "harmony " << arrangement.harmony_score / (double)SCORE_SCALE << "\n";
+		for (size_t t = 0; t < arrangement.tracks.size(); ++t)
+			report << "track_" << t << " " << arrangement.tracks[t] << " "
+				<< arrangement.track_scores[t] / (double)SCORE_SCALE << "\n";
+	}
+	if (convergence.enabled()) {
+		const vector<ConvergenceEvent>& restarts = convergence.restarts();
+		report << "restarts " << restarts.size() << "\n";
+		for (size_t r = 0; r < restarts.size(); ++r)
+			report << "restart_" << r << " " << restarts[r].generation << " "
+				<< convergenceReasonName(restarts[r].reason) << "\n";
+		// a run that did not converge ran out of generations
+		report << "stop_reason " << (convergence.stopped() ? convergenceReasonName(convergence.stop().reason) : "generations") << "\n"
+			<< "stop_generation " << (convergence.stopped() ? convergence.stop().generation : options.generations) << "\n";
+		if (convergence.stopped())
+			report << "stop_diversity " << convergence.stop().diversity << "\n";
+	}
+	if (options.multi_objective) {
+		report << "pareto_front " << front_size << "\n";
+		for (int j = 0; j < OBJECTIVES; ++j)
+			report << "best_" << objectiveName(j) << " "
+				<< pareto.objectivesOf(bestCompromise(pareto))[j] / (double)SCORE_SCALE << "\n";
+	}
+	report.close();
+	if (!report) {
+		fprintf(stderr, "Could not write %s\n", report_file.c_str());
+		return 1;
+	}
+
+	// encoded straight from the notes, without a music string for CFugue to parse
+	bool midi_written = arrangement.tracks.empty() ? saveMidiFile(best, midi_file)
+		: saveMidiFile(arrangement.tracks, midi_file);
+	if (!midi_written) {
+		fprintf(stderr, "Could not write %s\n", midi_file.c_str());
+		return 1;
+	}
+	return 0;
+}
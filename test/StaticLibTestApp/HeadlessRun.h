@@ -0,0 +1,96 @@
+// HeadlessRun.h
+//
+// The parts of a GA run that need no MIDI device: setting a run up from its command line
+// options (resuming a checkpoint, opening the telemetry, checkpoint and MIDI export outputs),
+// running single population generations, and the headless runner that writes its results to
+// files. Builds without CFugue, so the headless program (headlessGA) runs on servers with no
+// sound hardware; the interactive program in SampleApp.cpp shares it.
+
+#pragma once
+
+#include <string>
+#include "CommandLine.h"
+#include "Checkpoint.h"
+#include "Convergence.h"
+#include "GeneticAlgorithm.h"
+#include "IslandModel.h"
+#include "MidiExport.h"
+#include "MultiObjective.h"
+#include "MultiTrack.h"
+#include "Telemetry.h"
+
+/**
+* What a single population run writes in the background, each NULL unless its option is given.
+**/
+struct RunOutputs {
+	Telemetry* telemetry;			// --telemetry
+	CheckpointWriter* checkpoints;	// --checkpoint
+	MidiExporter* midi;				// --export-midi
+
+	RunOutputs() : telemetry(NULL), checkpoints(NULL), midi(NULL) {}
+};
+
+/**
+* A run set up from its options: the settings of a resumed checkpoint replace the ones of the
+* command line, the seed is picked and the key set, and the outputs are open.
+**/
+struct RunSetup {
+	RunOptions options;
+	unsigned long long seed;		// the same seed reproduces the whole run
+	Population population;			// the resumed population, empty for a new run
+	int first_generation;			// generations the resumed run has done
+	Telemetry telemetry;
+	CheckpointWriter checkpoints;
+	MidiExporter midi;
+	RunOutputs outputs;				// points at the outputs above that are open
+	ConvergenceMonitor convergence;	// stops (or restarts) a run that no longer improves
+
+	RunSetup() : seed(0), first_generation(0) {}
+
+private:
+	RunSetup(const RunSetup&);				// not copyable
+	RunSetup& operator=(const RunSetup&);
+};
+
+/**
+* Sets up a run from run.options. Returns false (after telling why) if the checkpoint to resume
+* cannot be, or an output cannot be opened.
+**/
+bool setUpRun(RunSetup& run);
+
+/**
+* Island model settings of a run.
+**/
+IslandOptions islandOptions(const RunOptions& run, unsigned long long seed);
+
+/**
+* Multi-track settings of a run.
+**/
+MultiTrackOptions multiTrackOptions(const RunOptions& run, unsigned long long seed);
+
+/**
+* Runs generation (or steady-state step) i + 1 of a single population run. With checkpoints, the
+* run is saved every --checkpoint-interval generations and after the last one, and with MIDI
+* export the best melody is handed to the exporter. With --converge the population is restarted
+* when it stalls, or the run stopped: returns true when this was the last generation of the run.
+**/
+bool runGeneration(const RunOptions& options, unsigned long long seed, Population& population, int i,
+	ThreadPool& pool, const RunOutputs& outputs, ConvergenceMonitor& convergence);
+
+/**
+* Waits for the checkpoints and MIDI files of a run to be written.
+* Returns false (after telling why) if any of them could not be.
+**/
+bool finishOutputs(const RunOptions& options, const RunOutputs& outputs);
+
+/**
+* Runs the GA without a MIDI device and without console input, for batch jobs on servers.
+* Writes the settings and the best melody to <output>.txt and the best melody to <output>.mid
+* (with --tracks, every track of the best arrangement). With --multi-objective the best melody is
+* the front member with the highest fitness, and the front goes to <output>_front.csv.
+* A single population run continues from the resumed population, if any, and writes the open
+* outputs. With --converge the report tells why and after which generation the run stopped,
+* and when it was restarted.
+* Returns the exit code of the program.
+**/
+int runHeadless(RunSetup& run);
@@ -0,0 +1,140 @@
+// IslandModel.cpp
+//
+// Island model genetic algorithm with ring migration between threads.
+
+#include "IslandModel.h"
+#include "GeneticAlgorithm.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+/**
+* A melody sent from one island to the next.
+**/
+struct Migrant {
+	Melody melody;
+	int score;
+
+	Migrant() : score(0) {}
+};
+
+/**
+* Bounded lock-free single producer / single consumer ring buffer of migrants.
+**/
+class MigrationQueue {
+public:
+	explicit MigrationQueue(size_t capacity) : slots(capacity), head(0), tail(0) {}
+
+	// Called by the sending island only. Returns false when the queue is full.
+	bool push(const Migrant& migrant) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == slots.size())
+			return false;
+		slots[t % slots.size()] = migrant;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Called by the receiving island only. Returns false when the queue is empty.
+	bool pop(Migrant& migrant) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+		migrant = slots[h % slots.size()];
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	std::vector<Migrant> slots;
+	std::atomic<size_t> head;	// next slot to read
+	std::atomic<size_t> tail;	// next slot to write
+};
+
+bool acceptMigrant(Population& population, const Melody& melody, int score) {
+	if (score <= population.parent2_score)
+		return false;
+
+	// the last one in the order of selectParents(), so never a parent of a population of three or more
+	selectBottomK(population.scores, 1, population.order);
+	size_t worst = population.order[0];
+	population.individuals[worst] = melody;
+	population.scores[worst] = score;
+	if (population.states_valid)
+		initFitnessState(population.states[worst], melody);
+
+	if (score > population.parent1_score) {
+		population.parent2_index = population.parent1_index;
+		population.parent2_score = population.parent1_score;
+		population.parent1_index = worst;
+		population.parent1_score = score;
+	}
+	else {
+		population.parent2_index = worst;
+		population.parent2_score = score;
+	}
+	return true;
+}
+
+IslandResult runIslands(const IslandOptions& options) {
+	const int islands = options.islands > 0 ? options.islands : 1;
+	const int interval = options.migration_interval > 0 ? options.migration_interval : 1;
+
+	std::vector<Population> populations(islands);
+	// queues[i] carries migrants from island i - 1 to island i. An island can run at most
+	// islands - 1 rounds ahead of the next one, so that many slots never fill up.
+	std::vector<std::unique_ptr<MigrationQueue>> queues;
+	for (int i = 0; i < islands; ++i)
+		queues.push_back(std::unique_ptr<MigrationQueue>(new MigrationQueue(islands + 1)));
+	std::atomic<unsigned long long> migrations(0);
+
+	auto runIsland = [&](int island) {
+		Population& population = populations[island];
+		const unsigned long long seed = islandSeed(options.seed, island);
+		MigrationQueue& outgoing = *queues[(island + 1) % islands];
+		MigrationQueue& incoming = *queues[island];
+
+		population.selection = options.selection;
+		population.crossover = options.crossover;
+		initPopulation(population, options.population_size, options.melody_length, seed, NULL);
+
+		for (int generation = 1; generation <= options.generations; ++generation) {
+			evolveGeneration(population, seed, generation, NULL);
+
+			if (islands < 2 || generation % interval != 0)
+				continue;
+
+			// send our best melody to the next island, then wait for the one of this round
+			Migrant migrant;
+			migrant.melody = population.parent1();
+			migrant.score = population.parent1_score;
+			while (!outgoing.push(migrant))
+				std::this_thread::yield();
+			while (!incoming.pop(migrant))
+				std::this_thread::yield();
+			if (acceptMigrant(population, migrant.melody, migrant.score))
+				migrations.fetch_add(1, std::memory_order_relaxed);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int island = 1; island < islands; ++island)
+		threads.push_back(std::thread(runIsland, island));
+	runIsland(0);
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+
+	IslandResult result;
+	result.migrations = migrations.load();
+	for (int island = 0; island < islands; ++island) {
+		const Population& population = populations[island];
+		result.island_scores.push_back(population.parent1_score);
+		if (island == 0 || population.parent1_score > result.best_score) {
+			result.best = population.parent1();
+			result.best_score = population.parent1_score;
+			result.best_island = island;
+		}
+	}
+	return result;
+}
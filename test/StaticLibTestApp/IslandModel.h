@@ -0,0 +1,57 @@
+// IslandModel.h
+//
+// Island model genetic algorithm: several sub-populations (islands) evolve independently,
+// each on its own thread, and every few generations each island sends its best melody to
+// the next island of a ring through a lock-free single producer / single consumer queue.
+//
+// Islands exchange migrants in lock step (an island waits for the migrant of the current
+// migration round before going on), so a run is reproducible from its seed even though the
+// islands run concurrently.
+
+#pragma once
+
+#include <vector>
+#include "GeneticAlgorithm.h"
+
+struct IslandOptions {
+	int islands;				// number of sub-populations, one thread each
+	int population_size;		// individuals per island
+	int melody_length;
+	int generations;
+	int migration_interval;		// generations between migrations
+	unsigned long long seed;
+	SelectionOptions selection;
+	CrossoverMethod crossover;
+
+	IslandOptions() : islands(4), population_size(10), melody_length(12), generations(1000),
+		migration_interval(10), seed(0), crossover(CROSSOVER_ONE_POINT) {}
+};
+
+struct IslandResult {
+	Melody best;						// best melody of all islands
+	int best_score;						// its fitness, in tenths
+	int best_island;
+	std::vector<int> island_scores;		// best fitness of each island, in tenths
+	unsigned long long migrations;		// migrants accepted by the islands
+
+	IslandResult() : best_score(0), best_island(0), migrations(0) {}
+};
+
+/**
+* Seed of one island, derived from the seed of the run.
+**/
+inline unsigned long long islandSeed(unsigned long long seed, int island) {
+	return seed + (unsigned long long)island * 0x9E3779B97F4A7C15ULL;
+}
+
+/**
+* Puts a migrant into the population in place of the worst individual, and makes it
+* a parent when it beats the current ones. Returns true if it was accepted.
+**/
+bool acceptMigrant(Population& population, const Melody& melody, int score);
+
+/**
+* Evolves options.islands populations in parallel and returns the best melody found.
+* Uses the key, scale and fitness cache set up in GeneticAlgorithm.h.
+**/
+IslandResult runIslands(const IslandOptions& options);
@@ -0,0 +1,129 @@
+// KeyFitness.cpp
+//
+// Run time selection of the key specialized fitness kernels.
+
+#include "KeyFitness.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <utility>
+
+// The kinds of kernel: Kernel::of<Tonic, Scale>() is the kernel of a key, of type Kernel::Function
+struct FitnessKernel {
+	typedef FitnessFunction Function;
+	template <int Tonic, unsigned int Scale>
+	static constexpr Function of() { return &KeyFitness<Tonic, Scale>::score; }
+};
+
+struct ObjectiveKernel {
+	typedef ObjectiveFunction Function;
+	template <int Tonic, unsigned int Scale>
+	static constexpr Function of() { return &KeyObjectives<Tonic, Scale>::score; }
+};
+
+struct TablesKernel {
+	typedef const FitnessTables* Function;
+	template <int Tonic, unsigned int Scale>
+	static constexpr Function of() { return &ScoreTables<KeyFitness<Tonic, Scale>>::tables; }
+};
+
+// One kernel per tonic for the major and minor scales, and one per melakarta raga (tonic C)
+template <typename Kernel, size_t... Tonics>
+static const typename Kernel::Function* majorKernels(std::index_sequence<Tonics...>) {
+	static const typename Kernel::Function kernels[] = { Kernel::template of<(int)Tonics, MAJOR_SCALE>()... };
+	return kernels;
+}
+
+template <typename Kernel, size_t... Tonics>
+static const typename Kernel::Function* minorKernels(std::index_sequence<Tonics...>) {
+	static const typename Kernel::Function kernels[] = { Kernel::template of<(int)Tonics, MINOR_SCALE>()... };
+	return kernels;
+}
+
+template <typename Kernel, size_t... Melas>
+static const typename Kernel::Function* melakartaKernels(std::index_sequence<Melas...>) {
+	static const typename Kernel::Function kernels[] = { Kernel::template of<0, melakartaScale((int)Melas + 1)>()... };
+	return kernels;
+}
+
+template <typename Kernel>
+static typename Kernel::Function keyKernel(const Key& key) {
+	switch (key.scale) {
+	case SCALE_MINOR:
+		return minorKernels<Kernel>(std::make_index_sequence<PITCH_CLASSES>())[key.tonic];
+	case SCALE_MELAKARTA:
+		return melakartaKernels<Kernel>(std::make_index_sequence<MELAKARTA_COUNT>())[key.mela - 1];
+	default:
+		return majorKernels<Kernel>(std::make_index_sequence<PITCH_CLASSES>())[key.tonic];
+	}
+}
+
+FitnessFunction keyFitnessFunction(const Key& key) {
+	return keyKernel<FitnessKernel>(key);
+}
+
+ObjectiveFunction keyObjectiveFunction(const Key& key) {
+	return keyKernel<ObjectiveKernel>(key);
+}
+
+const FitnessTables* keyFitnessTables(const Key& key) {
+	return keyKernel<TablesKernel>(key);
+}
+
+unsigned int keyPitchClasses(const Key& key) {
+	unsigned int scale = MAJOR_SCALE;
+	if (key.scale == SCALE_MINOR)
+		scale = MINOR_SCALE;
+	else if (key.scale == SCALE_MELAKARTA)
+		scale = melakartaScale(key.mela);
+
+	unsigned int pitch_classes = 0;
+	for (int pc = 0; pc < PITCH_CLASSES; ++pc)
+		if (inScale(key.tonic, scale, pc))
+			pitch_classes |= 1u << pc;
+	return pitch_classes;
+}
+
+bool parseKey(const std::string& name, Key& key) {
+	std::string text;
+	for (size_t i = 0; i < name.size(); ++i)
+		text += (char)tolower((unsigned char)name[i]);
+
+	if (text.compare(0, 5, "mela_") == 0) {
+		// the whole rest must be the number, without sign, spaces or a fraction
+		const char* digits = text.c_str() + 5;
+		char* end = NULL;
+		long mela = isdigit((unsigned char)*digits) ? strtol(digits, &end, 10) : 0;
+		if (!end || *end != '\0' || mela < 1 || mela > MELAKARTA_COUNT)
+			return false;
+		key = Key(0, SCALE_MELAKARTA, (int)mela);
+		return true;
+	}
+
+	// tonic letter with optional accidental, parsed as a note
+	size_t pos = 1;
+	if (pos < text.size() && (text[pos] == '#' || text[pos] == 'b'))
+		++pos;
+	Melody tonic_note = parseMelody(text.substr(0, pos));
+	if (tonic_note.size() != 1)
+		return false;
+	int tonic = notePitchClass(tonic_note[0]);
+
+	// optional scale
+	while (pos < text.size() && (text[pos] == ' ' || text[pos] == '_' || text[pos] == '-'))
+		++pos;
+	std::string scale = text.substr(pos);
+	if (scale.empty() || scale == "major" || scale == "maj")
+		key = Key(tonic, SCALE_MAJOR);
+	else if (scale == "minor" || scale == "min" || scale == "m")
+		key = Key(tonic, SCALE_MINOR);
+	else
+		return false;
+	return true;
+}
+
+std::string keyName(const Key& key) {
+	if (key.scale == SCALE_MELAKARTA)
+		return "MELA_" + std::to_string(key.mela);
+	return std::string(pitchClassName(key.tonic)) + (key.scale == SCALE_MINOR ? " minor" : " major");
+}
@@ -0,0 +1,153 @@
+// KeyFitness.h
+//
+// Fitness kernels specialized at compile time on the tonic and the scale of the key
+// the melodies are evolved in.
+//
+// A kernel is a composition of fitness terms (see FitnessTerms.h). Every term that looks at a
+// pair of adjacent notes (interval rewards, leap penalty, repeat penalty) plus a penalty for
+// notes outside of the scale is folded into a constexpr generated table indexed by the two
+// pitch classes and the octave difference. The hot loop therefore does a single table load per pair, with no map lookups
+// and no branches. Octave differences are clamped to [-2, 2]: any larger leap is more than
+// an octave away, where the table entries no longer change, so the clamp is exact.
+//
+// keyFitnessFunction() returns the kernel for a key chosen at run time, so one binary can
+// evolve melodies in every major and minor key and in the 72 Carnatic melakarta ragas.
+// keyFitnessTables() returns the same kernel as tables, for the delta and batch scoring.
+
+#pragma once
+
+#include <string>
+#include "FitnessTerms.h"
+
+// Scales, as bit sets of the pitch classes relative to the tonic
+const unsigned int MAJOR_SCALE = 0xAB5;	// 0 2 4 5 7 9 11
+const unsigned int MINOR_SCALE = 0x5AD;	// 0 2 3 5 7 8 10 (natural minor)
+
+// Score (in tenths) deducted for every note outside of the scale
+const int OUT_OF_SCALE_PENALTY = 5;
+
+const int MELAKARTA_COUNT = 72;
+
+/**
+* Scale of a Carnatic melakarta raga (1 - 72), as used by CFugue's K[MELA_n] directive.
+* The number picks the madhyamam (M1 for 1 - 36, M2 for 37 - 72), the rishabham/gandharam
+* pair (chakra) and the dhaivatam/nishadam pair.
+**/
+constexpr unsigned int melakartaScale(int mela) {
+	// semitone offsets of the 6 possible (R, G) and (D, N) pairs, relative to R1 and D1
+	const int lower[6] = { 0, 0, 0, 1, 1, 2 };
+	const int upper[6] = { 1, 2, 3, 2, 3, 3 };
+	int index = (mela - 1) % 36;
+	int chakra = index / 6;
+	int raga = index % 6;
+	int madhyamam = (mela <= 36) ? 5 : 6;
+	return (1u << 0)								// S
+		| (1u << (1 + lower[chakra]))				// R
+		| (1u << (1 + upper[chakra]))				// G
+		| (1u << madhyamam)							// M
+		| (1u << 7)									// P
+		| (1u << (8 + lower[raga]))					// D
+		| (1u << (8 + upper[raga]));				// N
+}
+
+constexpr bool inScale(int tonic, unsigned int scale, int pitch_class) {
+	return ((scale >> ((pitch_class - tonic + PITCH_CLASSES) % PITCH_CLASSES)) & 1) != 0;
+}
+
+/**
+* Penalizes notes outside of the scale of a key: the target of every pair and the first note.
+**/
+template <int Tonic, unsigned int Scale>
+struct OutOfScalePenalty : FitnessTerm {
+	static constexpr int pair(Note, Note to) {
+		return inScale(Tonic, Scale, notePitchClass(to)) ? 0 : -OUT_OF_SCALE_PENALTY;
+	}
+
+	static constexpr int melody(const MelodySummary& summary) {
+		return inScale(Tonic, Scale, notePitchClass(summary.first)) ? 0 : -OUT_OF_SCALE_PENALTY;
+	}
+};
+
+/**
+* Fitness of melodies in a key: the default terms with the tonic of the key, and the
+* out of scale penalty. The pair terms are folded into one table.
+**/
+template <int Tonic, unsigned int Scale>
+using KeyFitness = FitnessComposition<TabulatedPairs<IntervalReward, RepeatPenalty, OutOfScalePenalty<Tonic, Scale>>,
+	TonicEndpoints<Tonic>, PitchClassVariety>;
+
+/**
+* The objectives of multi-objective runs: the terms of the fitness in a key, each on its own.
+* They add up to the fitness in the key.
+**/
+enum Objective {
+	OBJECTIVE_CONSONANCE,		// consonant intervals, less leaps, repeats and notes out of the scale
+	OBJECTIVE_STEPWISE,			// stepwise motion
+	OBJECTIVE_TONIC,			// starting and ending on the tonic
+	OBJECTIVE_VARIETY			// distinct pitch classes
+};
+
+const int OBJECTIVES = 4;
+
+template <int Tonic, unsigned int Scale>
+using KeyObjectives = ObjectiveComposition<TabulatedPairs<ConsonanceReward, RepeatPenalty, OutOfScalePenalty<Tonic, Scale>>,
+	StepwiseMotion, TonicEndpoints<Tonic>, PitchClassVariety>;
+
+/**
+* Fitness (in tenths) of a melody in the given key. Same rules as fitnessScore(), with the
+* tonic bonus moved to the key's tonic and a penalty for every note outside of the scale.
+* For C major and melodies of natural notes the score equals fitnessScore().
+**/
+template <int Tonic, unsigned int Scale>
+int keyFitnessScore(const Note* notes, size_t length) {
+	return KeyFitness<Tonic, Scale>::score(notes, length);
+}
+
+enum ScaleType {
+	SCALE_MAJOR,
+	SCALE_MINOR,
+	SCALE_MELAKARTA
+};
+
+/**
+* The key melodies are evolved in. Melakarta ragas use C as their tonic (Sa), as in playCarnatic().
+**/
+struct Key {
+	int tonic;				// pitch class of the tonic
+	ScaleType scale;
+	int mela;				// melakarta number (1 - 72) for SCALE_MELAKARTA
+
+	Key() : tonic(0), scale(SCALE_MAJOR), mela(0) {}
+	Key(int tonic_, ScaleType scale_, int mela_ = 0) : tonic(tonic_), scale(scale_), mela(mela_) {}
+};
+
+/**
+* The fitness kernel specialized for a key.
+**/
+FitnessFunction keyFitnessFunction(const Key& key);
+
+/**
+* The objectives kernel for a key, see Objective.
+**/
+ObjectiveFunction keyObjectiveFunction(const Key& key);
+
+/**
+* The fitness kernel of a key as tables (see FitnessTables), generated from the same terms.
+**/
+const FitnessTables* keyFitnessTables(const Key& key);
+
+/**
+* Bit set of the (absolute) pitch classes in the scale of a key.
+**/
+unsigned int keyPitchClasses(const Key& key);
+
+/**
+* Parses a key name such as "C", "F# major", "A minor", "Bb minor" or "MELA_65".
+* Returns false if the name is not recognised.
+**/
+bool parseKey(const std::string& name, Key& key);
+
+/**
+* Name of a key, in the format accepted by parseKey().
+**/
+std::string keyName(const Key& key);
@@ -0,0 +1,142 @@
+// Melody.cpp
+//
+// Conversion between packed melody genomes and CFugue music strings.
+
+#include "Melody.h"
+
+#include <cctype>
+#include <cstring>
+#include <ostream>
+
+// Note names used when writing music strings, indexed by pitch class
+static const char* const pitch_class_names[PITCH_CLASSES] = {
+	"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"
+};
+
+// Pitch class of each natural note letter, indexed from 'A'
+static const int letter_to_pitch_class[7] = { 9, 11, 0, 2, 4, 5, 7 };
+
+// CFugue duration letters, indexed by NoteDuration
+static const char duration_letters[DURATIONS + 1] = "whqistxo";
+
+const char* pitchClassName(int pitchClass) {
+	return pitch_class_names[pitchClass];
+}
+
+/**
+* Parses a single note token (e.g. "C", "c#", "Bb4", "G10", "D6h") into a packed note.
+* Returns false when the token is not a plain note.
+**/
+static bool parseNoteToken(const std::string& token, Note& note) {
+	size_t pos = 0;
+	char letter = (char)toupper((unsigned char)token[pos]);
+	if (letter < 'A' || letter > 'G')
+		return false;
+	int pitchClass = letter_to_pitch_class[letter - 'A'];
+	++pos;
+
+	// accidentals
+	while (pos < token.size() && (token[pos] == '#' || token[pos] == 'b')) {
+		pitchClass += (token[pos] == '#') ? 1 : -1;
+		++pos;
+	}
+	pitchClass = (pitchClass % PITCH_CLASSES + PITCH_CLASSES) % PITCH_CLASSES;
+
+	// optional octave
+	int octave = DEFAULT_OCTAVE;
+	if (pos < token.size() && isdigit((unsigned char)token[pos])) {
+		octave = 0;
+		while (pos < token.size() && isdigit((unsigned char)token[pos])) {
+			octave = octave * 10 + (token[pos] - '0');
+			++pos;
+		}
+		if (octave > 10)
+			return false;
+	}
+
+	// optional duration
+	int duration = DURATION_QUARTER;
+	if (pos < token.size()) {
+		const char* letter = strchr(duration_letters, tolower((unsigned char)token[pos]));
+		if (letter && *letter)
+			duration = (int)(letter - duration_letters);
+	}
+
+	note = makeNote(pitchClass, octave, duration);
+	return true;
+}
+
+Melody parseMelody(const std::string& musicString) {
+	Melody melody;
+	size_t pos = 0;
+	while (pos < musicString.size()) {
+		// skip white space between tokens
+		while (pos < musicString.size() && isspace((unsigned char)musicString[pos]))
+			++pos;
+		size_t end = pos;
+		while (end < musicString.size() && !isspace((unsigned char)musicString[end]))
+			++end;
+		if (end > pos) {
+			Note note;
+			if (parseNoteToken(musicString.substr(pos, end - pos), note))
+				melody.notes.push_back(note);
+		}
+		pos = end;
+	}
+	return melody;
+}
+
+std::string toMusicString(const Melody& melody) {
+	std::string result;
+	result.reserve(melody.size() * 4);
+	for (size_t i = 0; i < melody.size(); ++i) {
+		if (i != 0)
+			result += ' ';
+		result += pitch_class_names[notePitchClass(melody[i])];
+		int octave = noteOctave(melody[i]);
+		if (octave != DEFAULT_OCTAVE)
+			result += std::to_string(octave);
+		int duration = noteDuration(melody[i]);
+		if (duration != DURATION_QUARTER)
+			result += duration_letters[duration];
+	}
+	return result;
+}
+
+/**
+* Final avalanche step (from splitmix64) so that melodies differing in a single
+* note end up in unrelated cache slots.
+**/
+static unsigned long long mixHash(unsigned long long h) {
+	h ^= h >> 30;
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+	return h;
+}
+
+unsigned long long melodyHash(const Melody& melody) {
+	const unsigned long long prime = 0x100000001b3ULL;
+	unsigned long long h = 0xcbf29ce484222325ULL ^ melody.size();
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(melody.notes.data());
+	const size_t byte_count = melody.size() * sizeof(Note);
+	const size_t word_size = sizeof(unsigned long long);
+	size_t i = 0;
+
+	// Hash whole 8 byte words first, then the remaining bytes
+	for (; i + word_size <= byte_count; i += word_size) {
+		unsigned long long word;
+		memcpy(&word, bytes + i, word_size);
+		h = (h ^ word) * prime;
+		h ^= h >> 32;
+	}
+	for (; i < byte_count; ++i)
+		h = (h ^ bytes[i]) * prime;
+
+	return mixHash(h);
+}
+
+std::ostream& operator<<(std::ostream& out, const Melody& melody) {
+	return out << toMusicString(melody);
+}
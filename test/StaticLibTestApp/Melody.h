@@ -0,0 +1,131 @@
+// Melody.h
+//
+// Genome representation used by the genetic algorithm.
+//
+// A melody is stored as a sequence of packed 16-bit notes (pitch class, octave and duration)
+// instead of a space separated CFugue music string. The GA operators work directly on the
+// packed notes, and a melody is only converted to/from a music string when it is played.
+
+#pragma once
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/**
+* A single packed note: the pitch class (0 = C .. 11 = B) lives in bits 0 - 3, the octave
+* (0 - 10, as used by CFugue) in bits 4 - 7 and the duration (see NoteDuration) in bits 8 - 10.
+* The remaining bits are zero. Two notes are the same pitch when their low bytes are equal.
+**/
+typedef unsigned short Note;
+
+const int PITCH_CLASSES = 12;	// semitones in an octave
+const int DEFAULT_OCTAVE = 5;	// CFugue plays a note without an octave suffix in octave 5
+const int MAX_OCTAVE = 10;		// the highest octave CFugue plays
+
+/**
+* Note values as the number of halvings of a whole note, in the order of the CFugue
+* duration letters w h q i s t x o.
+**/
+enum NoteDuration {
+	DURATION_WHOLE,
+	DURATION_HALF,
+	DURATION_QUARTER,			// CFugue plays a note without a duration letter as a quarter note
+	DURATION_EIGHTH,
+	DURATION_SIXTEENTH,
+	DURATION_THIRTY_SECOND,
+	DURATION_SIXTY_FOURTH,
+	DURATION_HUNDRED_TWENTY_EIGHTH
+};
+
+const int DURATIONS = 8;
+
+constexpr Note makeNote(int pitchClass, int octave = DEFAULT_OCTAVE, int duration = DURATION_QUARTER) {
+	return (Note)((duration << 8) | (octave << 4) | pitchClass);
+}
+
+constexpr int notePitchClass(Note note) {
+	return note & 0x0F;
+}
+
+constexpr int noteOctave(Note note) {
+	return (note >> 4) & 0x0F;
+}
+
+constexpr int noteDuration(Note note) {
+	return (note >> 8) & 0x07;
+}
+
+/**
+* The note with another pitch class, keeping its octave and duration.
+**/
+constexpr Note withPitchClass(Note note, int pitchClass) {
+	return (Note)((note & ~0x0F) | pitchClass);
+}
+
+const unsigned int QUARTER_NOTE_LENGTH = 32;	// in 128th notes
+
+/**
+* Length of a note in 128th notes, so durations add up exactly.
+**/
+constexpr unsigned int noteLength(Note note) {
+	return 128u >> noteDuration(note);
+}
+
+/**
+* Name of a pitch class as written in music strings ("C", "C#", .. "B").
+**/
+const char* pitchClassName(int pitchClass);
+
+/**
+* Absolute semitone value of a note, matching the CFugue note numbers (C5 = 60).
+* Used to measure intervals between notes, including leaps across octaves.
+**/
+constexpr int noteSemitone(Note note) {
+	return noteOctave(note) * PITCH_CLASSES + notePitchClass(note);
+}
+
+/**
+* A melody genome: an ordered sequence of packed notes.
+**/
+struct Melody {
+	std::vector<Note> notes;
+
+	Melody() {}
+	explicit Melody(size_t length, Note fill = makeNote(0)) : notes(length, fill) {}
+
+	size_t size() const { return notes.size(); }
+	bool empty() const { return notes.empty(); }
+
+	Note& operator[](size_t i) { return notes[i]; }
+	const Note& operator[](size_t i) const { return notes[i]; }
+
+	Note front() const { return notes.front(); }
+	Note back() const { return notes.back(); }
+
+	bool operator==(const Melody& other) const { return notes == other.notes; }
+	bool operator!=(const Melody& other) const { return notes != other.notes; }
+};
+
+/**
+* 64-bit hash of the notes of a melody, used to recognise identical genomes.
+**/
+unsigned long long melodyHash(const Melody& melody);
+
+/**
+* Builds a melody from a CFugue music string such as "C D E F" or "C#6h Bb4i G".
+* A note takes the first duration letter after its octave (so a dotted note loses its dot).
+* Tokens that are not plain notes (instruments, rests, chords etc.) are skipped.
+**/
+Melody parseMelody(const std::string& musicString);
+
+/**
+* Formats a melody as a CFugue music string, e.g. "C D E6h F". The octave is only written
+* for notes outside of the default octave, the duration only for notes other than quarters.
+**/
+std::string toMusicString(const Melody& melody);
+
+/**
+* Prints a melody as its music string.
+**/
+std::ostream& operator<<(std::ostream& out, const Melody& melody);
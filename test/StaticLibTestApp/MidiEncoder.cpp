@@ -0,0 +1,166 @@
+// MidiEncoder.cpp
+//
+// Direct conversion of melody genomes into MIDI events and Standard MIDI Files.
+
+#include "MidiEncoder.h"
+
+#include <cstdio>
+
+// The most bytes one note takes in a track: a one byte delta and two data bytes for the note on
+// (plus the running status once), a delta of up to four bytes and two data bytes for the note off
+static const size_t MAX_NOTE_BYTES = 10;
+static_assert(MAX_TICKS_PER_QUARTER * (128 / QUARTER_NOTE_LENGTH) < (1u << 28),
+	"the delta of the longest note must fit in four bytes");
+
+// File header, track header, tempo, program change and end of track
+static const size_t MAX_FRAME_BYTES = 14 + 8 + 7 + 3 + 4;
+
+void encodeMidiEvents(const Melody& melody, const MidiOptions& options, std::vector<MidiEvent>& events) {
+	events.resize(2 * melody.size());
+	const unsigned char note_on = (unsigned char)(0x90 | (options.channel & 0x0F));
+	for (size_t i = 0; i < melody.size(); ++i) {
+		const unsigned char key = midiKey(melody[i]);
+		MidiEvent& on = events[2 * i];
+		on.delta = 0;
+		on.status = note_on;
+		on.key = key;
+		on.velocity = (unsigned char)(options.velocity & 0x7F);
+		MidiEvent& off = events[2 * i + 1];
+		off.delta = noteTicks(melody[i], options);
+		off.status = note_on;
+		off.key = key;
+		off.velocity = 0;
+	}
+}
+
+/**
+* Writes a variable length quantity (7 bits per byte, most significant first) and returns the end.
+**/
+static unsigned char* writeVarLen(unsigned char* out, unsigned int value) {
+	unsigned char buffer[5];
+	int count = 0;
+	buffer[count++] = (unsigned char)(value & 0x7F);
+	while (value >>= 7)
+		buffer[count++] = (unsigned char)((value & 0x7F) | 0x80);
+	while (count)
+		*out++ = buffer[--count];
+	return out;
+}
+
+static unsigned char* writeBigEndian(unsigned char* out, unsigned int value, int bytes) {
+	while (bytes--)
+		*out++ = (unsigned char)(value >> (8 * bytes));
+	return out;
+}
+
+/**
+* Writes the header chunk of a file of the given format with track_count tracks.
+**/
+static unsigned char* writeHeader(unsigned char* out, int format, size_t track_count, const MidiOptions& options) {
+	static const unsigned char header[] = { 'M', 'T', 'h', 'd', 0, 0, 0, 6 };
+	for (size_t i = 0; i < sizeof(header); ++i)
+		*out++ = header[i];
+	out = writeBigEndian(out, format, 2);
+	out = writeBigEndian(out, (unsigned int)track_count, 2);
+	return writeBigEndian(out, ticksPerQuarter(options), 2);
+}
+
+/**
+* Writes the track chunk of a melody played on channel. Only the first track of a file
+* carries the tempo.
+**/
+static unsigned char* writeTrack(unsigned char* out, const Melody& melody, const MidiOptions& options,
+	unsigned char channel, bool tempo) {
+	static const unsigned char track[] = { 'M', 'T', 'r', 'k' };
+	for (size_t i = 0; i < sizeof(track); ++i)
+		*out++ = track[i];
+	unsigned char* track_length = out;
+	out += 4;
+	unsigned char* track_start = out;
+
+	// tempo meta event and program change
+	if (tempo) {
+		*out++ = 0;
+		*out++ = 0xFF;
+		*out++ = 0x51;
+		*out++ = 3;
+		out = writeBigEndian(out, options.tempo & 0xFFFFFF, 3);
+	}
+	*out++ = 0;
+	*out++ = (unsigned char)(0xC0 | channel);
+	*out++ = (unsigned char)(options.program & 0x7F);
+
+	// the notes, all under the running status of the first note on
+	const unsigned char velocity = (unsigned char)(options.velocity & 0x7F);
+	for (size_t i = 0; i < melody.size(); ++i) {
+		const unsigned char key = midiKey(melody[i]);
+		*out++ = 0;
+		if (i == 0)
+			*out++ = (unsigned char)(0x90 | channel);
+		*out++ = key;
+		*out++ = velocity;
+		out = writeVarLen(out, noteTicks(melody[i], options));
+		*out++ = key;
+		*out++ = 0;
+	}
+
+	// end of track
+	*out++ = 0;
+	*out++ = 0xFF;
+	*out++ = 0x2F;
+	*out++ = 0;
+
+	writeBigEndian(track_length, (unsigned int)(out - track_start), 4);
+	return out;
+}
+
+unsigned char trackChannel(const MidiOptions& options, size_t track) {
+	const unsigned int first = options.channel & 0x0F;
+	unsigned int channel = first + (unsigned int)track;
+	if (first < PERCUSSION_CHANNEL && channel >= PERCUSSION_CHANNEL)
+		channel++;
+	return (unsigned char)(channel & 0x0F);
+}
+
+void encodeMidiFile(const Melody& melody, const MidiOptions& options, std::vector<unsigned char>& bytes) {
+	bytes.resize(MAX_FRAME_BYTES + melody.size() * MAX_NOTE_BYTES);
+	unsigned char* out = writeHeader(&bytes[0], 0, 1, options);
+	out = writeTrack(out, melody, options, (unsigned char)(options.channel & 0x0F), true);
+	bytes.resize(out - &bytes[0]);
+}
+
+void encodeMidiFile(const std::vector<Melody>& tracks, const MidiOptions& options, std::vector<unsigned char>& bytes) {
+	size_t notes = 0;
+	for (size_t t = 0; t < tracks.size(); ++t)
+		notes += tracks[t].size();
+	bytes.resize(MAX_FRAME_BYTES * (tracks.size() + 1) + notes * MAX_NOTE_BYTES);
+	unsigned char* out = writeHeader(&bytes[0], 1, tracks.size(), options);
+	for (size_t t = 0; t < tracks.size(); ++t)
+		out = writeTrack(out, tracks[t], options, trackChannel(options, t), t == 0);
+	bytes.resize(out - &bytes[0]);
+}
+
+/**
+* Writes the bytes of a file to path. Returns false if it cannot be written.
+**/
+static bool writeFile(const std::vector<unsigned char>& bytes, const std::string& path) {
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+		return false;
+	bool written = fwrite(&bytes[0], 1, bytes.size(), file) == bytes.size();
+	if (fclose(file) != 0)
+		written = false;
+	return written;
+}
+
+bool saveMidiFile(const Melody& melody, const std::string& path, const MidiOptions& options) {
+	std::vector<unsigned char> bytes;
+	encodeMidiFile(melody, options, bytes);
+	return writeFile(bytes, path);
+}
+
+bool saveMidiFile(const std::vector<Melody>& tracks, const std::string& path, const MidiOptions& options) {
+	std::vector<unsigned char> bytes;
+	encodeMidiFile(tracks, options, bytes);
+	return writeFile(bytes, path);
+}
@@ -0,0 +1,99 @@
+// MidiEncoder.h
+//
+// Direct conversion of melody genomes into MIDI events and Standard MIDI Files.
+//
+// The notes are encoded straight from the packed genome, without formatting a music string and
+// having CFugue parse it back. Every note lasts its duration gene and is played on one channel
+// with the defaults CFugue uses for a plain music string (120 beats per minute, piano, velocity 64).
+// A file is a format 0 SMF with one track; note offs are written as note ons with velocity 0,
+// so the whole melody shares one running status byte. An arrangement of several melodies is a
+// format 1 SMF with one track per melody, each on its own channel.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Melody.h"
+
+// Channel General MIDI reserves for percussion, skipped when tracks get their channels
+const unsigned int PERCUSSION_CHANNEL = 9;
+
+// Finest time division a file header can hold, in ticks per quarter note (bit 15 selects SMPTE time)
+const unsigned int MAX_TICKS_PER_QUARTER = 0x7FFF;
+
+struct MidiOptions {
+	unsigned int ticks_per_quarter;		// time division of the file, 1 - MAX_TICKS_PER_QUARTER
+	unsigned int tempo;					// microseconds per quarter note
+	unsigned char channel;				// 0 - 15, of the first track
+	unsigned char program;				// General MIDI instrument, 0 = piano
+	unsigned char velocity;
+
+	MidiOptions() : ticks_per_quarter(480), tempo(500000), channel(0), program(0), velocity(64) {}
+};
+
+/**
+* A MIDI channel message and its delta time, in ticks since the previous event.
+**/
+struct MidiEvent {
+	unsigned int delta;
+	unsigned char status;				// message type and channel, e.g. 0x90 for note on, channel 0
+	unsigned char key;
+	unsigned char velocity;				// 0 ends the note
+};
+
+/**
+* MIDI key number of a note (C5 = 60, as in CFugue), limited to the MIDI range.
+**/
+inline unsigned char midiKey(Note note) {
+	int key = noteSemitone(note);
+	return (unsigned char)(key > 127 ? 127 : key);
+}
+
+/**
+* Time division of the options, limited to what a file header can hold, so that the header and
+* the note lengths always agree.
+**/
+inline unsigned int ticksPerQuarter(const MidiOptions& options) {
+	const unsigned int ticks = options.ticks_per_quarter;
+	return ticks < 1 ? 1 : (ticks > MAX_TICKS_PER_QUARTER ? MAX_TICKS_PER_QUARTER : ticks);
+}
+
+/**
+* Length of a note in ticks. The shortest notes are rounded down at coarse time divisions.
+**/
+inline unsigned int noteTicks(Note note, const MidiOptions& options) {
+	return ticksPerQuarter(options) * noteLength(note) / QUARTER_NOTE_LENGTH;
+}
+
+/**
+* The note on and note off events of a melody, in place of the contents of events.
+* The storage of events is reused.
+**/
+void encodeMidiEvents(const Melody& melody, const MidiOptions& options, std::vector<MidiEvent>& events);
+
+/**
+* A Standard MIDI File of the melody, in place of the contents of bytes.
+* The storage of bytes is reused, so encoding many melodies into one buffer does not allocate.
+**/
+void encodeMidiFile(const Melody& melody, const MidiOptions& options, std::vector<unsigned char>& bytes);
+
+/**
+* A format 1 Standard MIDI File of an arrangement, one track per melody, in place of the
+* contents of bytes. The tracks start together and each plays on its own channel.
+**/
+void encodeMidiFile(const std::vector<Melody>& tracks, const MidiOptions& options, std::vector<unsigned char>& bytes);
+
+/**
+* Channel of a track of an arrangement: the tracks follow options.channel, skipping percussion.
+**/
+unsigned char trackChannel(const MidiOptions& options, size_t track);
+
+/**
+* Writes the Standard MIDI File of a melody to path. Returns false if it cannot be written.
+**/
+bool saveMidiFile(const Melody& melody, const std::string& path, const MidiOptions& options = MidiOptions());
+
+/**
+* Writes the Standard MIDI File of an arrangement to path. Returns false if it cannot be written.
+**/
+bool saveMidiFile(const std::vector<Melody>& tracks, const std::string& path, const MidiOptions& options = MidiOptions());
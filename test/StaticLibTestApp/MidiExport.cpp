@@ -0,0 +1,121 @@
+// MidiExport.cpp
+//
+// Background export of the best melodies of a run to MIDI files.
+
+#include "MidiExport.h"
+#include "MidiEncoder.h"
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+
+// Queued melodies that wake the writer early; otherwise it writes a few times a second
+static const size_t EXPORT_BATCH = 16;
+
+MidiExporter::MidiExporter() : every(0), best_score(INT_MIN), head(0), tail(0), closing(false), failed(false),
+	exported_count(0), dropped_count(0) {}
+
+MidiExporter::~MidiExporter() {
+	close();
+}
+
+void MidiExporter::open(const std::string& prefix, int every, size_t capacity) {
+	close();
+	this->prefix = prefix;
+	this->every = every;
+	best_score = INT_MIN;
+	queue.assign(capacity ? capacity : 1, Export());
+	head = tail = 0;
+	closing = false;
+	failed = false;
+	exported_count = dropped_count = 0;
+	writer = std::thread(&MidiExporter::writerLoop, this);
+}
+
+void MidiExporter::record(unsigned long long generation, const Melody& best, int score) {
+	if (!writer.joinable())
+		return;
+	bool due = every > 0 ? generation % every == 0 : score > best_score;
+	if (!due)
+		return;
+	best_score = score;
+
+	bool wake_writer;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (tail - head == queue.size()) {
+			dropped_count++;
+			return;
+		}
+		// the slots keep their storage, so once they have held a melody this does not allocate
+		Export& slot = queue[tail % queue.size()];
+		slot.generation = generation;
+		slot.melody.notes.assign(best.notes.begin(), best.notes.end());
+		tail++;
+		wake_writer = tail - head == EXPORT_BATCH;
+	}
+	if (wake_writer)
+		wake.notify_one();
+}
+
+bool MidiExporter::close() {
+	if (writer.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closing = true;
+		}
+		wake.notify_one();
+		writer.join();
+	}
+	return !failed;
+}
+
+unsigned long long MidiExporter::exported() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return exported_count;
+}
+
+unsigned long long MidiExporter::dropped() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return dropped_count;
+}
+
+void MidiExporter::writerLoop() {
+	std::vector<Export> batch(queue.size());
+	for (;;) {
+		size_t count;
+		bool done;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait_for(lock, std::chrono::milliseconds(250),
+				[this] { return closing || tail - head >= EXPORT_BATCH; });
+			// take every queued melody at once, swapping storage with the slots
+			count = tail - head;
+			for (size_t i = 0; i < count; ++i) {
+				Export& slot = queue[(head + i) % queue.size()];
+				batch[i].generation = slot.generation;
+				std::swap(batch[i].melody, slot.melody);
+			}
+			head = tail;
+			done = closing;
+		}
+
+		unsigned long long written = 0;
+		bool write_failed = false;
+		for (size_t i = 0; i < count; ++i) {
+			char name[32];
+			snprintf(name, sizeof(name), "_%06llu.mid", batch[i].generation);
+			if (saveMidiFile(batch[i].melody, prefix + name))
+				written++;
+			else
+				write_failed = true;
+		}
+		if (count) {
+			std::lock_guard<std::mutex> lock(mutex);
+			exported_count += written;
+			failed = failed || write_failed;
+		}
+		if (done)
+			break;
+	}
+}
@@ -0,0 +1,70 @@
+// MidiExport.h
+//
+// Background export of the best melodies of a run to MIDI files.
+//
+// record() is called by the GA thread after every generation. The melodies that are due (those of
+// every Nth generation, or every new best) are copied into a bounded queue of preallocated slots,
+// and a writer thread encodes them (see MidiEncoder.h) and saves them in batches. When the writer
+// falls behind and the queue is full, further melodies are dropped and counted, so the generation
+// loop never waits on the disk.
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Melody.h"
+
+class MidiExporter {
+public:
+	MidiExporter();
+	~MidiExporter();
+
+	/**
+	* Starts exporting to PREFIX_<generation>.mid files. With every > 0 the best melody of every
+	* every-th generation is exported, otherwise the best melody whenever its score improves.
+	* capacity is the number of melodies the queue holds.
+	**/
+	void open(const std::string& prefix, int every, size_t capacity = 64);
+
+	/**
+	* Takes the best melody (and its score, in tenths) of a generation, and queues it if it is due.
+	* Never waits for the writer: a melody that does not fit into the queue is dropped.
+	**/
+	void record(unsigned long long generation, const Melody& best, int score);
+
+	/**
+	* Writes the queued melodies and stops the writer thread.
+	* Returns false if any file could not be written.
+	**/
+	bool close();
+
+	unsigned long long exported() const;	// files written
+	unsigned long long dropped() const;		// melodies dropped because the queue was full
+
+private:
+	MidiExporter(const MidiExporter&);				// not copyable
+	MidiExporter& operator=(const MidiExporter&);
+
+	struct Export {
+		unsigned long long generation;
+		Melody melody;
+	};
+
+	void writerLoop();
+
+	std::string prefix;
+	int every;
+	int best_score;							// of the last melody due, for exporting new bests
+	std::thread writer;
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<Export> queue;				// ring of preallocated slots, guarded by mutex
+	size_t head, tail;						// guarded by mutex, tail - head melodies are queued
+	bool closing;							// guarded by mutex
+	bool failed;							// guarded by mutex
+	unsigned long long exported_count;		// guarded by mutex
+	unsigned long long dropped_count;		// guarded by mutex
+};
@@ -0,0 +1,177 @@
+// MultiObjective.cpp
+//
+// Multi-objective genetic algorithm (NSGA-II).
+
+#include "MultiObjective.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+static const char* const objective_names[OBJECTIVES] = { "consonance", "stepwise", "tonic", "variety" };
+
+const char* objectiveName(int objective) {
+	return objective_names[objective];
+}
+
+/**
+* Runs task over [0, count) on the pool, or on the calling thread without one.
+**/
+template <typename Task>
+static void forRange(ThreadPool* pool, size_t count, const Task& task) {
+	if (pool)
+		pool->parallelFor(count, 0, task);
+	else
+		task(0, count);
+}
+
+/**
+* Scores the objectives of the individuals in [begin, end).
+**/
+static void scoreObjectives(ParetoPopulation& population, size_t begin, size_t end, ThreadPool* pool) {
+	forRange(pool, end - begin, [&](size_t first, size_t last) {
+		for (size_t i = begin + first; i < begin + last; ++i) {
+			const Melody& melody = population.individuals[i];
+			population.objective_function(melody.notes.data(), melody.size(), &population.objectives[i * OBJECTIVES]);
+		}
+	});
+}
+
+/**
+* NSGA-II's crowded comparison: the lower front wins, then the larger crowding distance.
+**/
+static inline bool crowdedBetter(const ParetoPopulation& population, size_t a, size_t b) {
+	if (population.ranks[a] != population.ranks[b])
+		return population.ranks[a] < population.ranks[b];
+	if (population.crowding[a] != population.crowding[b])
+		return population.crowding[a] > population.crowding[b];
+	return a < b;
+}
+
+static size_t crowdedTournament(const ParetoPopulation& population, RandomStream& rng) {
+	size_t a = rng.below((unsigned int)population.size);
+	size_t b = rng.below((unsigned int)population.size);
+	return crowdedBetter(population, a, b) ? a : b;
+}
+
+/**
+* Sorts the first count individuals into fronts and lists the keep individuals that survive in
+* chosen: whole fronts while they fit, then the least crowded members of the next one.
+**/
+static void rankAndSelect(ParetoPopulation& population, size_t count, size_t keep) {
+	const size_t fronts = population.sorter.sort(&population.objectives[0], count, OBJECTIVES, population.ranks);
+	population.crowding.resize(count);
+	population.chosen.clear();
+	for (size_t f = 0; f < fronts && population.chosen.size() < keep; ++f) {
+		const size_t* members = population.sorter.front(f);
+		const size_t front_size = population.sorter.frontSize(f);
+		crowdingDistance(&population.objectives[0], OBJECTIVES, members, front_size, population.crowding,
+			population.scratch);
+		if (population.chosen.size() + front_size <= keep) {
+			population.chosen.insert(population.chosen.end(), members, members + front_size);
+			continue;
+		}
+		const size_t needed = keep - population.chosen.size();
+		population.scratch.assign(members, members + front_size);
+		std::nth_element(population.scratch.begin(), population.scratch.begin() + needed, population.scratch.end(),
+			[&](size_t a, size_t b) {
+				if (population.crowding[a] != population.crowding[b])
+					return population.crowding[a] > population.crowding[b];
+				return a < b;
+			});
+		population.chosen.insert(population.chosen.end(), population.scratch.begin(), population.scratch.begin() + needed);
+	}
+}
+
+/**
+* Moves the chosen individuals to the front of the buffer, swapping the storage of the melodies.
+**/
+static void keepChosen(ParetoPopulation& population) {
+	const size_t count = population.chosen.size();
+	population.survivors.resize(count);
+	population.chosen_objectives.resize(count * OBJECTIVES);
+	population.chosen_ranks.resize(count);
+	population.chosen_crowding.resize(count);
+	for (size_t k = 0; k < count; ++k) {
+		const size_t i = population.chosen[k];
+		std::swap(population.survivors[k], population.individuals[i]);
+		std::copy(population.objectivesOf(i), population.objectivesOf(i) + OBJECTIVES,
+			&population.chosen_objectives[k * OBJECTIVES]);
+		population.chosen_ranks[k] = population.ranks[i];
+		population.chosen_crowding[k] = population.crowding[i];
+	}
+	// every chosen melody is out of the buffer now, so its slots only hold spare storage
+	for (size_t k = 0; k < count; ++k)
+		std::swap(population.individuals[k], population.survivors[k]);
+	std::copy(population.chosen_objectives.begin(), population.chosen_objectives.end(), population.objectives.begin());
+	std::copy(population.chosen_ranks.begin(), population.chosen_ranks.end(), population.ranks.begin());
+	std::copy(population.chosen_crowding.begin(), population.chosen_crowding.end(), population.crowding.begin());
+}
+
+void initParetoPopulation(ParetoPopulation& population, int size, int length, unsigned long long seed, ThreadPool* pool) {
+	population.size = size;
+	population.objective_function = keyObjectiveFunction(melody_key);
+	// the children of a generation are bred into the second half, whose storage is set up once, here
+	population.individuals.assign(2 * (size_t)size, Melody(length));
+	population.spare_children.assign(size, Melody(length));
+	population.survivors.assign(size, Melody(length));
+	population.chosen.reserve(size);
+	population.scratch.reserve(2 * (size_t)size);
+	population.objectives.resize(2 * (size_t)size * OBJECTIVES);
+	population.ranks.resize(2 * (size_t)size);
+	population.crowding.resize(2 * (size_t)size);
+	forRange(pool, size, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			RandomStream rng(seed, individualStream(0, i));
+			population.individuals[i] = generateNotes(length, rng);
+		}
+	});
+	scoreObjectives(population, 0, size, pool);
+	rankAndSelect(population, size, size);
+	keepChosen(population);
+}
+
+void evolveParetoGeneration(ParetoPopulation& population, unsigned long long seed, unsigned long long generation,
+	ThreadPool* pool) {
+	const size_t size = population.size;
+
+	// one child per slot, from parents that won crowded tournaments
+	forRange(pool, size, [&](size_t begin, size_t end) {
+		for (size_t j = begin; j < end; j++) {
+			RandomStream rng(seed, individualStream(generation, j));
+			const size_t parent1 = crowdedTournament(population, rng);
+			const size_t parent2 = crowdedTournament(population, rng);
+			Melody& child = population.individuals[size + j];
+			crossover(population.individuals[parent1], population.individuals[parent2], child,
+				population.spare_children[j], rng, population.crossover);
+			mutate(child, rng);
+		}
+	});
+	scoreObjectives(population, size, 2 * size, pool);
+
+	// parents and children compete for the places of the next generation
+	rankAndSelect(population, 2 * size, size);
+	keepChosen(population);
+}
+
+void paretoFront(const ParetoPopulation& population, std::vector<size_t>& front) {
+	front.clear();
+	for (size_t i = 0; i < population.size; ++i)
+		if (population.ranks[i] == 0)
+			front.push_back(i);
+}
+
+int objectiveSum(const ParetoPopulation& population, size_t i) {
+	const int* objectives = population.objectivesOf(i);
+	int sum = 0;
+	for (int j = 0; j < OBJECTIVES; ++j)
+		sum += objectives[j];
+	return sum;
+}
+
+size_t bestCompromise(const ParetoPopulation& population) {
+	size_t best = 0;
+	for (size_t i = 1; i < population.size; ++i)
+		if (population.ranks[i] == 0 && (population.ranks[best] != 0 || objectiveSum(population, i) > objectiveSum(population, best)))
+			best = i;
+	return best;
+}
@@ -0,0 +1,75 @@
+// MultiObjective.h
+//
+// Multi-objective genetic algorithm (NSGA-II): the terms of the fitness function are kept as
+// separate objectives (see Objective in KeyFitness.h) instead of being added up with fixed
+// weights, and the population converges on the Pareto front of the best trade-offs.
+//
+// Every generation breeds one child per individual with the usual crossover and mutation
+// operators, from parents picked by binary tournaments on (front, crowding distance). Parents
+// and children are sorted into fronts together (see Pareto.h), and the next generation is
+// filled front by front, the last front that does not fit being thinned out by crowding
+// distance. The melodies are kept in one buffer of parents and children whose storage is
+// reused, so once it is full a generation does not allocate.
+
+#pragma once
+
+#include <vector>
+#include "GeneticAlgorithm.h"
+#include "Pareto.h"
+
+struct ParetoPopulation {
+	size_t size;						// individuals that survive each generation
+	std::vector<Melody> individuals;	// the population in [0, size), its children in [size, 2 size)
+	std::vector<int> objectives;		// OBJECTIVES scores (in tenths) per individual
+	std::vector<int> ranks;				// front of each individual, 0 for the non-dominated ones
+	std::vector<double> crowding;		// crowding distance within the front, larger is lonelier
+	CrossoverMethod crossover;
+	ObjectiveFunction objective_function;	// the objectives in the key of the run
+
+	// storage reused from generation to generation
+	ParetoSorter sorter;
+	std::vector<Melody> spare_children;		// the second crossover child of every slot, dropped
+	std::vector<Melody> survivors;
+	std::vector<size_t> chosen;
+	std::vector<size_t> scratch;
+	std::vector<int> chosen_objectives;
+	std::vector<int> chosen_ranks;
+	std::vector<double> chosen_crowding;
+
+	ParetoPopulation() : size(0), crossover(CROSSOVER_ONE_POINT), objective_function(NULL) {}
+
+	const int* objectivesOf(size_t i) const { return &objectives[i * OBJECTIVES]; }
+};
+
+/**
+* Fills the population with random melodies (drawn from the streams of generation 0, like
+* initPopulation()), scores their objectives in the current key and ranks them.
+**/
+void initParetoPopulation(ParetoPopulation& population, int size, int length, unsigned long long seed, ThreadPool* pool);
+
+/**
+* Runs one NSGA-II generation. The children depend only on the seed and the generation,
+* never on the threads.
+**/
+void evolveParetoGeneration(ParetoPopulation& population, unsigned long long seed, unsigned long long generation,
+	ThreadPool* pool);
+
+/**
+* The individuals of the Pareto front (rank 0).
+**/
+void paretoFront(const ParetoPopulation& population, std::vector<size_t>& front);
+
+/**
+* Sum of the objectives of an individual: its fitness in the key of the run.
+**/
+int objectiveSum(const ParetoPopulation& population, size_t i);
+
+/**
+* The individual with the highest objective sum, from the Pareto front.
+**/
+size_t bestCompromise(const ParetoPopulation& population);
+
+/**
+* Name of an objective, e.g. "consonance".
+**/
+const char* objectiveName(int objective);
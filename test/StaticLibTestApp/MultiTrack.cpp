@@ -0,0 +1,132 @@
+// MultiTrack.cpp
+//
+// Multi-track genetic algorithm: one population and thread per voice.
+
+#include "MultiTrack.h"
+#include "Harmony.h"
+#include "IslandModel.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+* Blocks the threads of the tracks until all of them have finished a generation.
+**/
+class GenerationBarrier {
+public:
+	explicit GenerationBarrier(int count) : count(count), waiting(0), round(0) {}
+
+	void wait() {
+		std::unique_lock<std::mutex> lock(mutex);
+		const unsigned long long arrived = round;
+		if (++waiting == count) {
+			waiting = 0;
+			round++;
+			released.notify_all();
+			return;
+		}
+		released.wait(lock, [&] { return round != arrived; });
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable released;
+	const int count;
+	int waiting;					// guarded by mutex
+	unsigned long long round;		// guarded by mutex
+};
+
+/**
+* The best melodies of the tracks above and below a track, NULL at the outer voices.
+**/
+struct TrackNeighbours {
+	const Melody* above;
+	const Melody* below;
+
+	TrackNeighbours() : above(NULL), below(NULL) {}
+};
+
+/**
+* Harmony of a melody of a track with the adjacent tracks, see ContextFitnessFunction.
+**/
+static int trackHarmony(const Note* notes, size_t length, const void* context) {
+	const TrackNeighbours& neighbours = *static_cast<const TrackNeighbours*>(context);
+	int score = 0;
+	if (neighbours.above && !neighbours.above->empty())
+		score += timedHarmonyScore(notes, length, &neighbours.above->notes[0], neighbours.above->size());
+	if (neighbours.below && !neighbours.below->empty())
+		score += timedHarmonyScore(&neighbours.below->notes[0], neighbours.below->size(), notes, length);
+	return score;
+}
+
+/**
+* Moves every melody of the population into one octave.
+**/
+static void setOctave(Population& population, int octave) {
+	for (size_t i = 0; i < population.individuals.size(); ++i) {
+		Melody& melody = population.individuals[i];
+		for (size_t n = 0; n < melody.size(); ++n)
+			melody[n] = makeNote(notePitchClass(melody[n]), octave, noteDuration(melody[n]));
+	}
+}
+
+MultiTrackResult runMultiTrack(const MultiTrackOptions& options) {
+	const int tracks = options.tracks > 0 ? options.tracks : 1;
+
+	std::vector<Population> populations(tracks);
+	std::vector<TrackNeighbours> neighbours(tracks);
+	// best[g % 2] holds the best melody of every track after generation g (the initial one in
+	// best[0]); generation g reads the other buffer, which nobody writes until every track is
+	// done with it
+	std::vector<Melody> best[2] = { std::vector<Melody>(tracks), std::vector<Melody>(tracks) };
+	GenerationBarrier barrier(tracks);
+
+	auto runTrack = [&](int track) {
+		Population& population = populations[track];
+		const unsigned long long seed = islandSeed(options.seed, track);
+
+		population.selection = options.selection;
+		population.crossover = options.crossover;
+		initPopulation(population, options.population_size, options.melody_length, seed, NULL);
+		setOctave(population, trackOctave(track));
+		evaluate(population, NULL);
+		selectParents(population);
+		best[0][track] = population.parent1();
+		barrier.wait();
+
+		// from here on the melodies are scored together with the adjacent tracks
+		population.context_fitness = trackHarmony;
+		population.fitness_context = &neighbours[track];
+		for (int generation = 1; generation <= options.generations; ++generation) {
+			const std::vector<Melody>& previous = best[(generation - 1) % 2];
+			neighbours[track].above = track > 0 ? &previous[track - 1] : NULL;
+			neighbours[track].below = track + 1 < tracks ? &previous[track + 1] : NULL;
+			if (generation == 1) {
+				// the parents were picked before the other tracks were known
+				evaluate(population, NULL);
+				selectParents(population);
+			}
+			evolveGeneration(population, seed, generation, NULL);
+			best[generation % 2][track] = population.parent1();
+			barrier.wait();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int track = 1; track < tracks; ++track)
+		threads.push_back(std::thread(runTrack, track));
+	runTrack(0);
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+
+	MultiTrackResult result;
+	for (int track = 0; track < tracks; ++track) {
+		result.tracks.push_back(populations[track].parent1());
+		result.track_scores.push_back(fitness_cache.score(result.tracks.back()));
+		result.total_score += result.track_scores.back();
+	}
+	result.harmony_score = arrangementHarmony(result.tracks);
+	result.total_score += result.harmony_score;
+	return result;
+}
@@ -0,0 +1,49 @@
+// MultiTrack.h
+//
+// Multi-track genetic algorithm: an arrangement of several voices, each evolved by its own
+// population on its own thread (cooperative coevolution).
+//
+// A melody of a track is scored by its own fitness plus its harmony (see Harmony.h) with the
+// current best melodies of the adjacent tracks, which the tracks exchange after every
+// generation. The tracks run in lock step and read the best melodies of the previous generation
+// from a double buffer, so a run is reproducible from its seed.
+
+#pragma once
+
+#include <vector>
+#include "GeneticAlgorithm.h"
+
+struct MultiTrackOptions {
+	int tracks;					// voices, one population and thread each
+	int population_size;		// individuals per track
+	int melody_length;
+	int generations;
+	unsigned long long seed;
+	SelectionOptions selection;
+	CrossoverMethod crossover;
+
+	MultiTrackOptions() : tracks(2), population_size(10), melody_length(12), generations(1000), seed(0),
+		crossover(CROSSOVER_ONE_POINT) {}
+};
+
+struct MultiTrackResult {
+	std::vector<Melody> tracks;			// best melody of each track, track 0 is the highest voice
+	std::vector<int> track_scores;		// fitness of each of those melodies on its own, in tenths
+	int harmony_score;					// harmony of the arrangement, in tenths
+	int total_score;					// the track scores plus the harmony
+
+	MultiTrackResult() : harmony_score(0), total_score(0) {}
+};
+
+/**
+* Octave the melodies of a track are generated in: one octave below the track above it.
+**/
+inline int trackOctave(int track) {
+	return DEFAULT_OCTAVE - track > 0 ? DEFAULT_OCTAVE - track : 0;
+}
+
+/**
+* Evolves an arrangement of options.tracks voices and returns the best melody of each.
+* Uses the key, scale and fitness cache set up in GeneticAlgorithm.h.
+**/
+MultiTrackResult runMultiTrack(const MultiTrackOptions& options);
@@ -0,0 +1,103 @@
+// Pareto.cpp
+//
+// Pareto ranking for multi-objective optimization: a fast non-dominated sort and the crowding
+// distance of NSGA-II.
+
+#include "Pareto.h"
+
+#include <algorithm>
+#include <limits>
+
+size_t ParetoSorter::sort(const int* objectives, size_t count, int objective_count, std::vector<int>& ranks) {
+	ranks.resize(count);
+	order.resize(count);
+	for (size_t i = 0; i < count; ++i)
+		order[i] = i;
+	// best first in the first objective, then the next; equal vectors by index, so the order is deterministic
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		const int* x = objectives + a * objective_count;
+		const int* y = objectives + b * objective_count;
+		for (int j = 0; j < objective_count; ++j)
+			if (x[j] != y[j])
+				return x[j] > y[j];
+		return a < b;
+	});
+
+	// there are at most count fronts; the lists live in arrays of the population size
+	const size_t none = (size_t)-1;
+	size_t front_count = 0;
+	front_last.resize(count);
+	previous.resize(count);
+
+	for (size_t k = 0; k < count; ++k) {
+		const size_t i = order[k];
+		const int* candidate = objectives + i * objective_count;
+		if (k > 0 && std::equal(candidate, candidate + objective_count, objectives + order[k - 1] * objective_count)) {
+			ranks[i] = ranks[order[k - 1]];
+			continue;
+		}
+		// a member of front f dominating the candidate has a dominator in every front before f,
+		// so the fronts that dominate the candidate are a prefix
+		size_t low = 0, high = front_count;
+		while (low < high) {
+			const size_t mid = low + (high - low) / 2;
+			bool dominated = false;
+			// the latest members are the closest to the candidate in the sort order, so check them first
+			for (size_t m = front_last[mid]; m != none && !dominated; m = previous[m])
+				dominated = dominates(objectives + m * objective_count, candidate, objective_count);
+			if (dominated)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+		if (low == front_count)
+			front_last[front_count++] = none;
+		previous[i] = front_last[low];
+		front_last[low] = i;
+		ranks[i] = (int)low;
+	}
+
+	// group all individuals by front (counting sort over the ranks, keeping the lexicographic order),
+	// with room for as many fronts as individuals, so that a sort with more fronts does not allocate
+	front_begin.reserve(count + 1);
+	front_fill.reserve(count);
+	front_begin.assign(front_count + 1, 0);
+	for (size_t i = 0; i < count; ++i)
+		front_begin[ranks[i] + 1]++;
+	for (size_t f = 0; f < front_count; ++f)
+		front_begin[f + 1] += front_begin[f];
+	members.resize(count);
+	front_fill.assign(front_count, 0);
+	for (size_t k = 0; k < count; ++k) {
+		const size_t i = order[k];
+		members[front_begin[ranks[i]] + front_fill[ranks[i]]++] = i;
+	}
+	return front_count;
+}
+
+void crowdingDistance(const int* objectives, int objective_count, const size_t* members, size_t count,
+	std::vector<double>& distance, std::vector<size_t>& scratch) {
+	const double infinity = std::numeric_limits<double>::infinity();
+	for (size_t k = 0; k < count; ++k)
+		distance[members[k]] = count > 2 ? 0 : infinity;
+	if (count <= 2)
+		return;
+
+	scratch.assign(members, members + count);
+	for (int j = 0; j < objective_count; ++j) {
+		std::sort(scratch.begin(), scratch.end(), [&](size_t a, size_t b) {
+			int x = objectives[a * objective_count + j], y = objectives[b * objective_count + j];
+			return x != y ? x < y : a < b;
+		});
+		const int low = objectives[scratch.front() * objective_count + j];
+		const int high = objectives[scratch.back() * objective_count + j];
+		distance[scratch.front()] = infinity;
+		distance[scratch.back()] = infinity;
+		if (high == low)
+			continue;
+		const double scale = 1.0 / (high - low);
+		for (size_t k = 1; k + 1 < count; ++k)
+			distance[scratch[k]] += (objectives[scratch[k + 1] * objective_count + j]
+				- objectives[scratch[k - 1] * objective_count + j]) * scale;
+	}
+}
@@ -0,0 +1,65 @@
+// Pareto.h
+//
+// Pareto ranking for multi-objective optimization: a fast non-dominated sort and the crowding
+// distance of NSGA-II.
+//
+// The sort is ENS-BS (efficient non-dominated sort with binary search, Zhang et al. 2015). The
+// individuals are sorted lexicographically by their objectives, so an individual can only be
+// dominated by the ones before it, and each one is put into the first front that has no member
+// dominating it, found by binary search over the fronts. Identical objective vectors always
+// share a front, so only the first of each is placed; with the small integer objectives of the
+// melodies most of a large population are duplicates. Objectives are maximized.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class ParetoSorter {
+public:
+	/**
+	* Sorts count individuals into fronts by their objectives (objective_count per individual,
+	* objectives[i * objective_count + j] is objective j of individual i).
+	* ranks[i] becomes the front of individual i, 0 for the non-dominated ones.
+	* Returns the number of fronts. The storage is reused, so once it has grown to the
+	* population size a sort does not allocate.
+	**/
+	size_t sort(const int* objectives, size_t count, int objective_count, std::vector<int>& ranks);
+
+	/**
+	* The individuals of front f of the last sort, in lexicographic order of their objectives.
+	**/
+	const size_t* front(size_t f) const { return &members[front_begin[f]]; }
+	size_t frontSize(size_t f) const { return front_begin[f + 1] - front_begin[f]; }
+
+private:
+	std::vector<size_t> order;			// individuals, in lexicographic order
+	// the distinct objective vectors of each front, as a list from the latest placed back:
+	// front_last[f] is the latest of front f and previous[i] the one placed before i
+	std::vector<size_t> front_last;
+	std::vector<size_t> previous;
+	std::vector<size_t> members;		// every individual, grouped by front
+	std::vector<size_t> front_begin;	// start of each front in members, and the end
+	std::vector<size_t> front_fill;		// members of each front placed so far while grouping
+};
+
+/**
+* Crowding distance of the count members of one front: the sum over the objectives of the
+* normalized distance between the neighbours on either side. The extremes of every objective
+* get an infinite distance. distance is indexed by individual; scratch is reused storage.
+**/
+void crowdingDistance(const int* objectives, int objective_count, const size_t* members, size_t count,
+	std::vector<double>& distance, std::vector<size_t>& scratch);
+
+/**
+* True when a is at least as good as b in every objective and better in one.
+**/
+inline bool dominates(const int* a, const int* b, int objective_count) {
+	bool better = false;
+	for (int j = 0; j < objective_count; ++j) {
+		if (a[j] < b[j])
+			return false;
+		better = better || a[j] > b[j];
+	}
+	return better;
+}
@@ -0,0 +1,372 @@
+// ProcessIslands.cpp
+//
+// Island model genetic algorithm with one process per island and POSIX shared memory migration.
+
+#include "ProcessIslands.h"
+
+#ifdef _WIN32
+
+ProcessIslandResult runProcessIslands(const IslandOptions& options, bool) {
+	// no fork() and shm_open() here, run the islands as threads instead
+	ProcessIslandResult result;
+	static_cast<IslandResult&>(result) = runIslands(options);
+	return result;
+}
+
+#else
+
+#include "GeneticAlgorithm.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+enum IslandState { ISLAND_RUNNING, ISLAND_FINISHED, ISLAND_CRASHED };
+
+// Generations an island can publish before it has to wait for the coordinator to catch up
+static const size_t STATS_CAPACITY = 4096;
+
+// Records in the segment start on their own cache line, so islands do not false-share
+static const size_t CACHE_LINE = 64;
+
+/**
+* Statistics of one generation of one island, sent to the coordinator.
+**/
+struct IslandStats {
+	int generation;
+	int best;
+	int worst;
+	int count;
+	long long sum;
+};
+
+/**
+* Shared state of one island. It is followed in the segment by the two best melody buffers,
+* the ring of migrants sent to this island and the ring of statistics it sends to the coordinator.
+**/
+struct IslandBlock {
+	std::atomic<int> state;
+	std::atomic<int> best_buffer;		// best melody buffer last completely written, -1 before the first
+	int best_score[2];
+	std::atomic<size_t> migrant_head, migrant_tail;
+	std::atomic<size_t> stats_head, stats_tail;
+};
+
+/**
+* Byte layout of the shared memory segment: a header and one block per island.
+* Melodies have a fixed length in a run, so every record has a fixed size.
+**/
+class SharedSegment {
+public:
+	SharedSegment(int islands, int melody_length) : base(NULL), size(0), islands(islands), melody_length(melody_length) {
+		melody_bytes = align(melody_length * sizeof(Note));
+		migrant_bytes = CACHE_LINE + melody_bytes;	// score, then the notes on the next line
+		ring_capacity = islands + 1;
+		island_bytes = align(sizeof(IslandBlock)) + 2 * melody_bytes
+			+ ring_capacity * migrant_bytes + STATS_CAPACITY * sizeof(IslandStats);
+		size = align(sizeof(std::atomic<unsigned long long>)) + islands * island_bytes;
+	}
+
+	~SharedSegment() {
+		if (base)
+			munmap(base, size);
+	}
+
+	/**
+	* Creates the segment. The name is unlinked right away: the islands inherit the mapping
+	* when they are forked, and nothing is left behind in /dev/shm if the coordinator dies.
+	**/
+	bool create() {
+		char name[64];
+		snprintf(name, sizeof(name), "/cfugue_ga_%ld", (long)getpid());
+		int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0)
+			return false;
+		shm_unlink(name);
+		bool sized = ftruncate(fd, (off_t)size) == 0;
+		void* mapping = sized ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+		close(fd);
+		if (mapping == MAP_FAILED)
+			return false;
+		base = (unsigned char*)mapping;
+
+		new (migrations()) std::atomic<unsigned long long>(0);
+		for (int i = 0; i < islands; ++i) {
+			IslandBlock* block = new (island(i)) IslandBlock;
+			block->state.store(ISLAND_RUNNING);
+			block->best_buffer.store(-1);
+			block->migrant_head.store(0);
+			block->migrant_tail.store(0);
+			block->stats_head.store(0);
+			block->stats_tail.store(0);
+		}
+		return true;
+	}
+
+	std::atomic<unsigned long long>* migrations() { return (std::atomic<unsigned long long>*)base; }
+	IslandBlock* island(int i) { return (IslandBlock*)(base + align(sizeof(std::atomic<unsigned long long>)) + i * island_bytes); }
+	Note* bestMelody(int i, int buffer) { return (Note*)((unsigned char*)island(i) + align(sizeof(IslandBlock)) + buffer * melody_bytes); }
+	unsigned char* migrant(int i, size_t slot) {
+		return (unsigned char*)bestMelody(i, 2) + (slot % ring_capacity) * migrant_bytes;
+	}
+	IslandStats* stats(int i, size_t slot) {
+		return (IslandStats*)((unsigned char*)bestMelody(i, 2) + ring_capacity * migrant_bytes) + slot % STATS_CAPACITY;
+	}
+
+	int islandCount() const { return islands; }
+	int melodyLength() const { return melody_length; }
+	size_t ringCapacity() const { return ring_capacity; }
+
+private:
+	static size_t align(size_t bytes) { return (bytes + CACHE_LINE - 1) & ~(CACHE_LINE - 1); }
+
+	unsigned char* base;
+	size_t size;
+	int islands;
+	int melody_length;
+	size_t melody_bytes;
+	size_t migrant_bytes;
+	size_t ring_capacity;
+	size_t island_bytes;
+};
+
+/**
+* Sends a migrant to island `to`. Gives up when that island is no longer running.
+**/
+static void sendMigrant(SharedSegment& segment, int to, const Melody& melody, int score) {
+	IslandBlock* block = segment.island(to);
+	size_t t = block->migrant_tail.load(std::memory_order_relaxed);
+	while (t - block->migrant_head.load(std::memory_order_acquire) == segment.ringCapacity()) {
+		if (block->state.load(std::memory_order_acquire) != ISLAND_RUNNING)
+			return;
+		sched_yield();
+	}
+	unsigned char* slot = segment.migrant(to, t);
+	memcpy(slot, &score, sizeof(int));
+	memcpy(slot + CACHE_LINE, &melody.notes[0], segment.melodyLength() * sizeof(Note));
+	block->migrant_tail.store(t + 1, std::memory_order_release);
+}
+
+/**
+* Waits for the migrant of this round from island `from`. Returns false when that island
+* stopped running without sending one.
+**/
+static bool receiveMigrant(SharedSegment& segment, int island, int from, Melody& melody, int& score) {
+	IslandBlock* block = segment.island(island);
+	size_t h = block->migrant_head.load(std::memory_order_relaxed);
+	for (;;) {
+		// check the sender first: everything it sent before stopping is visible after this
+		bool stopped = segment.island(from)->state.load(std::memory_order_acquire) != ISLAND_RUNNING;
+		if (h != block->migrant_tail.load(std::memory_order_acquire))
+			break;
+		if (stopped)
+			return false;
+		sched_yield();
+	}
+	const unsigned char* slot = segment.migrant(island, h);
+	memcpy(&score, slot, sizeof(int));
+	melody.notes.resize(segment.melodyLength());
+	memcpy(&melody.notes[0], slot + CACHE_LINE, segment.melodyLength() * sizeof(Note));
+	block->migrant_head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+/**
+* Publishes the statistics of a generation and the best melody of the island.
+**/
+static void publishGeneration(SharedSegment& segment, int island, int generation, const Population& population) {
+	IslandBlock* block = segment.island(island);
+
+	// write the buffer that is not published, then switch, so a crash never leaves a torn melody
+	int current = block->best_buffer.load(std::memory_order_relaxed);
+	int next = current == 0 ? 1 : 0;
+	memcpy(segment.bestMelody(island, next), &population.parent1().notes[0], segment.melodyLength() * sizeof(Note));
+	block->best_score[next] = population.parent1_score;
+	block->best_buffer.store(next, std::memory_order_release);
+
+	IslandStats stats;
+	stats.generation = generation;
+	stats.best = population.parent1_score;
+	stats.worst = *std::min_element(population.scores.begin(), population.scores.end());
+	stats.count = (int)population.scores.size();
+	stats.sum = 0;
+	for (size_t i = 0; i < population.scores.size(); ++i)
+		stats.sum += population.scores[i];
+
+	size_t t = block->stats_tail.load(std::memory_order_relaxed);
+	while (t - block->stats_head.load(std::memory_order_acquire) == STATS_CAPACITY)
+		sched_yield();
+	*segment.stats(island, t) = stats;
+	block->stats_tail.store(t + 1, std::memory_order_release);
+}
+
+/**
+* Body of an island process.
+**/
+static void runIslandProcess(SharedSegment& segment, const IslandOptions& options, int island) {
+	const int islands = segment.islandCount();
+	const int interval = options.migration_interval > 0 ? options.migration_interval : 1;
+	const unsigned long long seed = islandSeed(options.seed, island);
+	const int previous = (island + islands - 1) % islands;
+	const int next = (island + 1) % islands;
+	bool previous_running = true;
+
+	Population population;
+	population.selection = options.selection;
+	population.crossover = options.crossover;
+	initPopulation(population, options.population_size, options.melody_length, seed, NULL);
+	publishGeneration(segment, island, 0, population);
+
+	for (int generation = 1; generation <= options.generations; ++generation) {
+		evolveGeneration(population, seed, generation, NULL);
+
+		if (islands > 1 && generation % interval == 0) {
+			// same lock-step exchange as the threaded islands, minus the islands that are gone
+			sendMigrant(segment, next, population.parent1(), population.parent1_score);
+			Melody melody;
+			int score = 0;
+			if (previous_running)
+				previous_running = receiveMigrant(segment, island, previous, melody, score);
+			if (previous_running && acceptMigrant(population, melody, score))
+				segment.migrations()->fetch_add(1, std::memory_order_relaxed);
+		}
+		publishGeneration(segment, island, generation, population);
+	}
+}
+
+/**
+* Moves the statistics the islands published into the per-generation totals.
+* Returns the number of records read.
+**/
+static size_t drainStats(SharedSegment& segment, std::vector<GenerationStats>& generations, std::vector<long long>& sums,
+	std::vector<long long>& counts) {
+	size_t drained = 0;
+	for (int i = 0; i < segment.islandCount(); ++i) {
+		IslandBlock* block = segment.island(i);
+		size_t h = block->stats_head.load(std::memory_order_relaxed);
+		size_t t = block->stats_tail.load(std::memory_order_acquire);
+		for (; h != t; ++h, ++drained) {
+			const IslandStats& stats = *segment.stats(i, h);
+			if (stats.generation < 0 || stats.generation >= (int)generations.size())
+				continue;
+			GenerationStats& total = generations[stats.generation];
+			if (total.islands == 0 || stats.best > total.best)
+				total.best = stats.best;
+			if (total.islands == 0 || stats.worst < total.worst)
+				total.worst = stats.worst;
+			total.islands++;
+			sums[stats.generation] += stats.sum;
+			counts[stats.generation] += stats.count;
+		}
+		block->stats_head.store(h, std::memory_order_release);
+	}
+	return drained;
+}
+
+ProcessIslandResult runProcessIslands(const IslandOptions& options, bool pin_cpus) {
+	const int islands = options.islands > 0 ? options.islands : 1;
+
+	SharedSegment segment(islands, options.melody_length);
+	if (options.melody_length <= 0 || !segment.create()) {
+		fprintf(stderr, "No shared memory for the island processes, running them as threads\n");
+		ProcessIslandResult result;
+		static_cast<IslandResult&>(result) = runIslands(options);
+		return result;
+	}
+
+	const pid_t coordinator = getpid();
+	const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	std::vector<pid_t> pids(islands, -1);
+	fflush(NULL);	// or the children would flush the coordinator's buffered output again
+	for (int i = 0; i < islands; ++i) {
+		pid_t pid = fork();
+		if (pid == 0) {
+#ifdef __linux__
+			// an orphaned island would wait on its ring forever
+			prctl(PR_SET_PDEATHSIG, SIGKILL);
+			if (getppid() != coordinator)
+				_exit(1);
+			if (pin_cpus && cpus > 0) {
+				cpu_set_t set;
+				CPU_ZERO(&set);
+				CPU_SET((int)(i % cpus), &set);
+				sched_setaffinity(0, sizeof(set), &set);
+			}
+#else
+			(void)coordinator;
+			(void)cpus;
+			(void)pin_cpus;
+#endif
+			runIslandProcess(segment, options, i);
+			segment.island(i)->state.store(ISLAND_FINISHED, std::memory_order_release);
+			_exit(0);
+		}
+		pids[i] = pid;
+		if (pid < 0)
+			segment.island(i)->state.store(ISLAND_CRASHED, std::memory_order_release);
+	}
+
+	// coordinate: collect the statistics and notice the islands that exit
+	ProcessIslandResult result;
+	std::vector<GenerationStats>& generations = result.generations;
+	generations.resize(options.generations > 0 ? options.generations + 1 : 1);
+	std::vector<long long> sums(generations.size(), 0), counts(generations.size(), 0);
+	int running = 0;
+	for (int i = 0; i < islands; ++i)
+		if (pids[i] > 0)
+			running++;
+	while (running > 0) {
+		size_t drained = drainStats(segment, generations, sums, counts);
+		for (int i = 0; i < islands; ++i) {
+			int status = 0;
+			if (pids[i] <= 0 || waitpid(pids[i], &status, WNOHANG) != pids[i])
+				continue;
+			pids[i] = -1;
+			running--;
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+				int state = ISLAND_RUNNING;
+				segment.island(i)->state.compare_exchange_strong(state, ISLAND_CRASHED);
+			}
+		}
+		if (drained == 0)
+			usleep(1000);
+	}
+	drainStats(segment, generations, sums, counts);
+
+	for (size_t g = 0; g < generations.size(); ++g) {
+		generations[g].generation = (int)g;
+		generations[g].mean = counts[g] ? sums[g] / (double)counts[g] : 0;
+	}
+
+	result.migrations = segment.migrations()->load();
+	bool found = false;
+	for (int i = 0; i < islands; ++i) {
+		IslandBlock* block = segment.island(i);
+		if (block->state.load() != ISLAND_FINISHED)
+			result.crashed_islands++;
+		int buffer = block->best_buffer.load(std::memory_order_acquire);
+		int score = buffer < 0 ? 0 : block->best_score[buffer];
+		result.island_scores.push_back(score);
+		if (buffer < 0 || (found && score <= result.best_score))
+			continue;
+		const Note* notes = segment.bestMelody(i, buffer);
+		result.best.notes.assign(notes, notes + options.melody_length);
+		result.best_score = score;
+		result.best_island = i;
+		found = true;
+	}
+	return result;
+}
+
+#endif
@@ -0,0 +1,44 @@
+// ProcessIslands.h
+//
+// Island model genetic algorithm with every island in its own process. The islands exchange
+// migrants through single producer / single consumer rings in a POSIX shared memory segment,
+// and the calling process acts as the coordinator: it watches the islands, collects the
+// per-generation statistics they publish and picks the global best melody at the end.
+//
+// Since the islands do not share an address space, one crashing island does not end the run.
+// Its neighbours stop exchanging migrants with it and the remaining islands carry on.
+//
+// Only available on POSIX systems. Elsewhere runProcessIslands() falls back to the threaded
+// island model of IslandModel.h.
+
+#pragma once
+
+#include <vector>
+#include "IslandModel.h"
+
+/**
+* Statistics of one generation, aggregated over the islands that reported it.
+**/
+struct GenerationStats {
+	int generation;
+	int islands;			// islands that reported this generation
+	int best;				// best fitness over the islands, in tenths
+	int worst;				// worst fitness over the islands, in tenths
+	double mean;			// mean fitness of all individuals of these islands, in tenths
+
+	GenerationStats() : generation(0), islands(0), best(0), worst(0), mean(0) {}
+};
+
+struct ProcessIslandResult : IslandResult {
+	int crashed_islands;						// islands that did not finish their run
+	std::vector<GenerationStats> generations;	// one entry per generation, 0 is the initial population
+
+	ProcessIslandResult() : crashed_islands(0) {}
+};
+
+/**
+* Evolves options.islands populations, each in a forked child process, and returns the best
+* melody found. With pin_cpus each island is bound to CPU (island mod CPU count), which keeps an
+* island and its memory on one NUMA node when the CPUs of a node are numbered together.
+**/
+ProcessIslandResult runProcessIslands(const IslandOptions& options, bool pin_cpus);
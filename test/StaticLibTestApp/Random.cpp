@@ -0,0 +1,105 @@
+// Random.cpp
+//
+// Counter-based random number streams for the genetic algorithm.
+
+#include "Random.h"
+
+static inline void mulhilo(unsigned int a, unsigned int b, unsigned int& hi, unsigned int& lo) {
+	unsigned long long product = (unsigned long long)a * b;
+	hi = (unsigned int)(product >> 32);
+	lo = (unsigned int)product;
+}
+
+void Philox4x32::block(const unsigned int counter[4], const unsigned int key[2], unsigned int out[4]) {
+	const unsigned int M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+	const unsigned int W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+	unsigned int c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+	unsigned int k0 = key[0], k1 = key[1];
+	for (int round = 0; round < 10; ++round) {
+		unsigned int hi0, lo0, hi1, lo1;
+		mulhilo(M0, c0, hi0, lo0);
+		mulhilo(M1, c2, hi1, lo1);
+		c0 = hi1 ^ c1 ^ k0;
+		c1 = lo1;
+		c2 = hi0 ^ c3 ^ k1;
+		c3 = lo0;
+		k0 += W0;
+		k1 += W1;
+	}
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+RandomStream::RandomStream(unsigned long long seed, unsigned long long stream)
+	: seed_value(seed), stream_id(stream), block_index(0), buffered(0) {
+}
+
+/**
+* Generates block number index of the stream into out.
+**/
+static inline void streamBlock(unsigned long long seed, unsigned long long stream, unsigned long long index, unsigned int out[4]) {
+	const unsigned int counter[4] = {
+		(unsigned int)index, (unsigned int)(index >> 32),
+		(unsigned int)stream, (unsigned int)(stream >> 32)
+	};
+	const unsigned int key[2] = { (unsigned int)seed, (unsigned int)(seed >> 32) };
+	Philox4x32::block(counter, key, out);
+}
+
+void RandomStream::refill() {
+	streamBlock(seed_value, stream_id, block_index++, buffer);
+	buffered = 4;
+}
+
+unsigned int RandomStream::below(unsigned int bound) {
+	unsigned long long product = (unsigned long long)next() * bound;
+	unsigned int low = (unsigned int)product;
+	if (low < bound) {
+		// reject the few values that would make the result biased
+		unsigned int threshold = (0u - bound) % bound;
+		while (low < threshold) {
+			product = (unsigned long long)next() * bound;
+			low = (unsigned int)product;
+		}
+	}
+	return (unsigned int)(product >> 32);
+}
+
+double RandomStream::uniform() {
+	// 53 random bits (two separate statements, so the order of the calls is fixed)
+	unsigned long long high = next() >> 5;
+	unsigned long long low = next() >> 6;
+	unsigned long long bits = (high << 26) | low;
+	return bits * (1.0 / 9007199254740992.0);
+}
+
+void RandomStream::fill(unsigned int* out, size_t count) {
+	// drain what is left of the current block first
+	while (count > 0 && buffered > 0) {
+		*out++ = next();
+		--count;
+	}
+	// then whole blocks straight into the output
+	while (count >= 4) {
+		streamBlock(seed_value, stream_id, block_index++, out);
+		out += 4;
+		count -= 4;
+	}
+	while (count > 0) {
+		*out++ = next();
+		--count;
+	}
+}
+
+void RandomStream::seek(unsigned long long position) {
+	block_index = position / 4;
+	buffered = 0;
+	unsigned int skip = (unsigned int)(position % 4);
+	if (skip != 0) {
+		refill();
+		buffered -= skip;
+	}
+}
@@ -0,0 +1,74 @@
+// Random.h
+//
+// Counter-based random number streams for the genetic algorithm.
+//
+// Numbers come from the Philox4x32-10 block function, which maps a 128-bit counter and a
+// 64-bit key to four random 32-bit words. A stream is identified by (seed, stream id): the
+// seed is the key and the stream id fills the high half of the counter, so every stream is
+// independent and can be created anywhere without shared state. Giving each individual of
+// each generation its own stream makes a run bit-reproducible from its seed, no matter how
+// many threads produce the individuals or in which order.
+
+#pragma once
+
+#include <cstddef>
+
+/**
+* Philox4x32-10 block function.
+**/
+struct Philox4x32 {
+	static void block(const unsigned int counter[4], const unsigned int key[2], unsigned int out[4]);
+};
+
+class RandomStream {
+public:
+	RandomStream(unsigned long long seed = 0, unsigned long long stream = 0);
+
+	/**
+	* Next random 32-bit word.
+	**/
+	unsigned int next() {
+		if (buffered == 0)
+			refill();
+		return buffer[4 - buffered--];
+	}
+
+	/**
+	* Uniform integer in [0, bound). Unbiased (multiply-shift with rejection).
+	**/
+	unsigned int below(unsigned int bound);
+
+	/**
+	* Uniform double in [0, 1).
+	**/
+	double uniform();
+
+	/**
+	* Fills out with count random 32-bit words, generating whole blocks at a time.
+	**/
+	void fill(unsigned int* out, size_t count);
+
+	/**
+	* Position in the stream, so the stream can be saved and resumed exactly.
+	**/
+	unsigned long long seed() const { return seed_value; }
+	unsigned long long stream() const { return stream_id; }
+	unsigned long long position() const { return block_index * 4 - buffered; }
+	void seek(unsigned long long position);
+
+private:
+	void refill();
+
+	unsigned long long seed_value;
+	unsigned long long stream_id;
+	unsigned long long block_index;	// next block to generate
+	unsigned int buffer[4];
+	unsigned int buffered;			// unread words left in buffer
+};
+
+/**
+* Stream id for an individual of a generation, so every individual draws from its own stream.
+**/
+inline unsigned long long individualStream(unsigned long long generation, unsigned long long individual) {
+	return (generation << 32) ^ individual;
+}
@@ -25,13 +25,34 @@ version 5.0
 #include "stdlib.h"
 #include <iostream>
 #include <string>
-#include "/projects/471_EC/include/CFugueLib.h" // specifies path for CFugue Library header file on my machine
+#include "CFugueLib.h" // found through the include directories of the build (CFugue's include folder)
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #include <string> 
 #include <locale>
 #include <codecvt>
+#include <set>
 #include <unordered_set>
 #include <vector>
+#include <fstream>
+#include <chrono>
+#include <memory>
+#include "Melody.h"
+#include "GeneticAlgorithm.h"
+#include "IslandModel.h"
+#include "MultiObjective.h"
+#include "MultiTrack.h"
+#include "ProcessIslands.h"
+#include "Checkpoint.h"
+#include "Convergence.h"
+#include "HeadlessRun.h"
+#include "MidiExport.h"
+#include "MidiEncoder.h"
+#include "Audition.h"
+#include "CommandLine.h"
+#include "Telemetry.h"
+#include "ThreadPool.h"
 
 
 /*
@@ -46,14 +67,6 @@ using namespace std;
 // Set nPortID, and nTimerRes to defaults, can be overridden with cmd arguments
 int nPortID = MIDI_MAPPER, nTimerRes = 20;
 
-// In order to accurately measure intervals between the notes in the default octave (5) we need to map the notes in order.
-// This will ensure that if there is a big leap between notes we can determine the value using the difference between the semitones.
-
-// Initialize the map with semitone values
-std::map<char, int> note_to_semitone = {
-	{'C', 0}, {'D', 2}, {'E', 4},
-	{'F', 5}, {'G', 7}, {'A', 9}, {'B', 11}
-};
 
 
 /*** These functions are part of the CFugue library for debugging the parser ***/
@@ -73,28 +86,6 @@ void OnParseError(const CFugue::CParser*, CFugue::CParser::ErrorEventHandlerArgs
 /*** End of CFugue Library parser functions ***/
 
 /******************** Helper Functions ***************************/
-/**
-* Helper function to 'erase' all white space from a melody, to ensure that
-* the fitness function does not score against empty notes
-**/
-string removeSpaces(const std::string& input) {
-	std::string output = input;
-	output.erase(std::remove(output.begin(), output.end(), ' '), output.end());
-	return output;
-}
-
-/***
-* Helper function to calculate the appropriate interval given two notes
-***/
-int calculateInterval(char note1, char note2) {
-	// Get the semitone value for each note
-	int semitone1 = note_to_semitone[note1];
-	int semitone2 = note_to_semitone[note2];
-
-	// Calculate and return the interval (absolute difference)
-	return abs(semitone2 - semitone1);
-}
-
 /**
 * Helper function to allow regular strings to be passed into CFugue functions,
 * by converting string to microsoft specific type: TCHAR
@@ -123,178 +114,9 @@ string separate_with_space(const string& str) {
 
 
 // GENETIC ALGORITHM FUNCTIONS
-/**
-Generate Random Melody
-**/
-std::string generateNotes(int length) {
-	std::string notes = "C D E F G A B";
-	std::string generatedNotes = "";
-	//srand(time(0));
-
-	/*for (int i = 0; i < length; i++) {
-		int index = rand() % 7 * 2;
-		generatedNotes += notes.substr(index, 1);
-		if (i != length - 1) {
-			generatedNotes += " ";
-		}
-	}*/
-	for (int i = 0; i < length; i++) {
-		int index = rand() % 7 * 2;
-		generatedNotes += notes.substr(index, 1);
-
-		// Randomly decide whether to add a number from 0 to 10
-		/*if (rand() % 2 == 0) {
-			generatedNotes += std::to_string(rand() % 11);
-		}
-		*/
-	
-		if (i != length - 1) {
-			generatedNotes += " ";
-		}
-	}
-
-	return generatedNotes;
-}
-
-/**
-* Calculates melody fitness. The parents for the next generation would be chosen based on their fitness,
-* with higher fitness melodies having a higher chance of being selected.
-* This function awards points for consonant intervals (unison, perfect fourth, perfect fifth),
-* starting and ending on the tonic ('C'), and subtracts points for repeated notes to encourage diversity and adherence to tone
-* reference: https://www.researchgate.net/publication/287009971_A_fitness_function_for_computer-generated_music_using_genetic_algorithms
-**/
-double fitness(const std::string& input) {
-	double score = 0.0;
-	unordered_set<char> unique_notes;
-	int interval = 0;
-	int octave = 0;
-
-	// TODO: TEST THIS CHANGE 
-	string melody = removeSpaces(input); // so that the current implementation of the fitness function does not score against ' '
-	// Add points for each consonant interval
-	for (int i = 0; i < melody.size() - 1; ++i) {
-		// Logic for checking large jumps between notes (interval and octave)
-		octave = 0; // reset octave
-		if (isalpha(melody[i]) && isdigit(melody[i + 1])) {
-			// Current character is a letter and the next character is a number
-			//cout << "Found letter followed by number: " << melody[i] << melody[i + 1] << endl;
-			octave = melody[i + 1]; // store the octave 
-		}
-		else {
-			interval = calculateInterval(melody[i], melody[i + 1]);
-		}
-		//cout << " interval =" << interval;
-		//cout << ", octave = " << octave << endl;
-
-		if (interval == 0 || interval == 5 || interval == 7) { // Unison, perfect fourth, perfect fifth
-			//cout << " points added for unison ";
-			score += 1.0;
-		}
-		else if (interval == 4 || interval == 9) { // Major third, Major sixth
-			//cout << " points added for major third, major sixth ";
-			score += 0.7;
-		}
-		else if (interval == 12) { // Octave
-			//cout << " points added for octave ";
-			score += 1.5;
-		}
-		if (interval > 7) { // Penalize large jumps
-			//cout << " points deducted for large jump ";
-			score -= 0.5;
-		}
-		unique_notes.insert(melody[i]); // build out unique notes set
-
-		// Add points for stepwise motion (small interval changes)
-		if (interval == 1 || interval == 2) { // Half step or whole step
-			//cout << " points added for small interval changes ";
-			score += 0.6;
-		}
-	}
-
-	// Add points for starting and ending on the tonic (in this case, 'C')
-	if (melody.front() == 'C') {  
-		//cout << " points added for starting on tonic C ";
-		score += 1.0;
-	}
-	if (melody.back() == 'C') {
-		//cout << " points added for ending on tonic C ";
-		score += 1.0;
-	}
-
-	// Subtrac              t points for each repeated note
-	for (int i = 0; i < melody.size() - 1; ++i) {
-		if (melody[i] == melody[i + 1]) {
-			//cout << " points deducted for repeated notes ";
-			score -= 0.2;
-		}
-	}
-
-	// Add points for variety of notes used
-	//cout << " points totalled: " << score;
-	score += 0.5 * unique_notes.size();
-	//cout << "  possible additional points awarded for uniqueness ";
-
-	return score;
-}
-
-
-/**
-* randomly select a position within the string and change
-* the note at that position to a different random note.
-*
-* examples of mutation algorithms:
-* https://www.geeksforgeeks.org/mutation-algorithms-for-string-manipulation-ga/
-**/
-void mutate(std::string& melody) {
-	// Define our musical notes
-	const std::string notes = "ABCDEFG";
-
-	// Create a version of melody without spaces
-	std::string melodyNoSpaces = removeSpaces(melody);
-
-	// Randomly select a position in the melody without spaces
-	int positionNoSpaces = rand() % melodyNoSpaces.size();
-
-	// Find the equivalent position in the original melody
-	int position = 0;
-	for (int i = 0, j = 0; i < melody.size() && j < positionNoSpaces; ++i) {
-		if (melody[i] != ' ') {
-			++j;
-		}
-		position = i;
-	}
-
-	// Randomly select a new note
-	char new_note = notes[rand() % notes.size()];
-
-	// Apply the mutation
-	melody[position] = new_note;
-}
-
-
-/**
-* Two strings are picked from the mating pool at random to
-* crossover in order to produce superior offspring.
-* reference: https://www.geeksforgeeks.org/crossover-in-genetic-algorithm/
-**/
-// TODO: Perform crossover between two melodies
-std::pair<std::string, std::string> crossover(const std::string& parent1, const std::string& parent2) {
-	// Make sure parents are the same size
-	//assert(parent1.size() == parent2.size());
-
-	// Randomly select a crossover point
-	int crossover_point = rand() % parent1.size();
-
-	// Create children by swapping subsequences after the crossover point
-	std::string child1 = parent1.substr(0, crossover_point) + parent2.substr(crossover_point);
-	std::string child2 = parent2.substr(0, crossover_point) + parent1.substr(crossover_point);
-
-	return std::make_pair(child1, child2);
-}
-
 
 // Display a melody
-void display_melody(string melody) { //const std::vector<Note>& melody
+void display_melody(const Melody& melody) {
 	// Implement melody display
 	std::cout << melody;
 	/*_tprintf(_T(melody));*/
@@ -389,19 +211,54 @@ void runAll() {
 }
 
 
+/**
+* Music string that plays the tracks of an arrangement together, each as its own CFugue voice.
+**/
+string arrangementMusicString(const vector<Melody>& tracks) {
+	string music;
+	for (size_t t = 0; t < tracks.size(); ++t)
+		music += (t ? " V" : "V") + to_string(t) + " " + toMusicString(tracks[t]);
+	return music;
+}
+
+
 int main(int argc, char* argv[])
 {
-	srand(time(0)); // seed the current time for random generator
-	const int population_size = 10; // set the population size to 10
+	RunSetup run;
+	RunOptions& options = run.options;
+	bool help = false;
+	string error;
+	if (!parseCommandLine(argc, argv, options, help, error)) {
+		fprintf(stderr, "%s\n%s", error.c_str(), usage(argv[0]).c_str());
+		return 2;
+	}
+	if (help) {
+		printf("%s", usage(argv[0]).c_str());
+		return 0;
+	}
+
+	// resumes a checkpoint, picks the seed and opens the outputs the options ask for
+	if (!setUpRun(run))
+		return 1;
+	if (options.headless)
+		return runHeadless(run);
+	const unsigned long long seed = run.seed;
+	Population& population = run.population;
+	const int first_generation = run.first_generation;
+	const RunOutputs& outputs = run.outputs;
+	ConvergenceMonitor& convergence = run.convergence;
+
+	const int population_size = options.population_size; // 10 unless set with --population
 	// e.g. the parents and run for several generations to simulate genetic mutation and crossover effects on subsequent generations (e.g. children)
 
-	const int num_tracks = 2; // set the number of midi tracks to 2 
-	const int generations = 1000; // run for 100 generations
+	const int num_tracks = options.tracks; // 1 unless set with --tracks, more evolves that many voices together
+	const int generations = options.generations; // 1000 unless set with --generations
+	const int islands = options.islands; // more than 1 evolves that many populations in parallel (island model)
 
 	//_tprintf(_T("\nHello World!!\n\n"));
 	_tprintf(_T("\n -------- Welcome to the Genetic Algo Music Program! ------------\n"));
 
-	if (argc < 2)
+	if (!options.port_given)
 	{
 		unsigned int nOutPortCount = CFugue::GetMidiOutPortCount();
 		if (nOutPortCount <= 0)
@@ -425,18 +282,15 @@ int main(int argc, char* argv[])
 			std::wcout << "\nUsing the MIDI output port: " << portName.c_str();
 		}
 	}
-	else if (argc == 2)
-	{
-		nPortID = atoi(argv[1]);
-	}
-	else if (argc > 2)
+	else
 	{
-		nPortID = atoi(argv[1]);
-		nTimerRes = atoi(argv[2]);
+		nPortID = options.port;
+		nTimerRes = options.timer_resolution;
 	}
 
-	// generate a string of 10 randomly generated notes
-	string generatedNotes = generateNotes(10);
+	// generate a melody of 10 randomly generated notes
+	RandomStream demo_rng(seed, individualStream(0, population_size));
+	Melody generatedNotes = generateNotes(10, demo_rng);
 
 	string mel = "C D E F G A B";
 	string mel2 = "B E G A B D A";
@@ -463,124 +317,172 @@ int main(int argc, char* argv[])
 	// we would need to implement more genetic algorithms aside from simple mutations to get the very best fitness scores.
 	// but will continue to test as scores seemed to only increase before my last code changes. 
 	//////////////////////
-	vector<string> population(population_size);
-
-	// generate initial population 
-	for (int i = 0; i < population_size; i++) {
-		population[i] = generateNotes(12);
-	}
 
 	// start with two parents, modify the melodies using GA, compare offspring and improve melodies based on fitness values
-	string parent1 = mel;
-	string parent2 = mel2;
-
-	double best_fitness = -100;
-	double second_best_fitness = -100;
-	string best_individual, second_best_individual;
-
-
-	// select the two parents
-	for (int i = 0; i < population_size; i++) {
-		cout << "current melody: " << population[i] << endl;
-		cout << "fitness of current melody: " << fitness(population[i]) << endl;
-		double current_fitness = fitness(population[i]);
-		if (current_fitness > best_fitness) {
-			// Current individual has better fitness than the best so far
-			// The old best becomes the second best
-			second_best_fitness = best_fitness;
-			second_best_individual = best_individual;
-
-			best_fitness = current_fitness;
-			best_individual = population[i];
-		}
-		else if (current_fitness > second_best_fitness) {
-			// Current individual only has better fitness than the second best
-			second_best_fitness = current_fitness;
-			second_best_individual = population[i];
+	Melody parent1 = parseMelody(mel);
+	Melody parent2 = parseMelody(mel2);
+	vector<Melody> arrangement; // the voices of a multi-track run, played together at the end
+	bool outputs_written = true; // false if a checkpoint or MIDI export could not be written
+
+	// plays each new best while the generations keep running, with --audition
+	std::unique_ptr<Audition> audition;
+	if (options.audition)
+		audition.reset(new Audition(nPortID, nTimerRes));
+
+	cout << "random seed: " << seed << endl;
+	if (islands > 1) {
+		// island model: the sub-populations evolve on their own threads and exchange their best melodies
+		ProcessIslandResult result;
+		if (options.island_processes)
+			result = runProcessIslands(islandOptions(options, seed), options.pin_cpus);
+		else
+			static_cast<IslandResult&>(result) = runIslands(islandOptions(options, seed));
+		for (int i = 0; i < islands; i++)
+			cout << "island " << i << " best fitness: " << result.island_scores[i] / (double)SCORE_SCALE << endl;
+		cout << "accepted migrants: " << result.migrations << endl;
+		if (!result.generations.empty()) {
+			const GenerationStats& last = result.generations.back();
+			cout << "last generation: best " << last.best / (double)SCORE_SCALE << ", mean " << last.mean / SCORE_SCALE
+				<< ", worst " << last.worst / (double)SCORE_SCALE << " over " << last.islands << " islands" << endl;
+			cout << "crashed islands: " << result.crashed_islands << endl;
 		}
-		cout << "current best fitness: " << best_fitness << endl;
-		cout << "current second best fitness: " << second_best_fitness << endl;
+		parent1 = result.best;
+		cout << "Best melody = " << parent1 << " with fitness = " << result.best_score / (double)SCORE_SCALE
+			<< " (island " << result.best_island << ")" << endl;
 	}
-	// set the two best parents from the population pool
-	parent1 = best_individual;
-	parent2 = second_best_individual;
-	cout << "parent 1: " << parent1 << endl;
-	cout << "parent 1 fitness score: " << fitness(parent1) << endl;
-	cout << "playing parent 1 from gen 0: " << endl;
-	std::wstring wmelpi1 = stringToWstring(parent1); // call the string conversion function
-	const TCHAR* p1 = wmelpi1.c_str(); // convert string melody into const TCHAR* to be used in the CFugue functions
-	CFugue::PlayMusicStringWithOpts(p1, nPortID, nTimerRes);
-
-	cout << "parent 2: " << parent2 << endl;
-	cout << "parent 2 fitness score: " << fitness(parent2) << endl;
-	cout << "playing parent 2 from gen 0: " << endl;
-	std::wstring wmelpi2 = stringToWstring(parent2); // call the string conversion function
-	const TCHAR* p2 = wmelpi2.c_str(); // convert string melody into const TCHAR* to be used in the CFugue functions
-	CFugue::PlayMusicStringWithOpts(p2, nPortID, nTimerRes);
-
-
-	// run simulated generations, applying GA
-	for (int i = 0; i < generations; i++) {
-		// Generate new population
-		for (int j = 0; j < population_size; j++) {
-			// TODO: add another GA implementation, crossover. 
-			// Create new melody by crossover
-			// Perform crossover to generate children
-			auto children = crossover(parent1, parent2);
-			//population[j] = crossover(parent1, parent2); 
-			// Apply mutation
-			//mutate(population[j]);
-			mutate(children.first);
-			mutate(children.second);
-
-			// update population with the best fit child
-			if (fitness(children.first) > fitness(children.second)) {
-				population[j] = children.first;
-			}
-			else {
-				population[j] = children.second;
-			}
-			// population j for generation i has been set, 
-			// selection has been implemented here as one of the crossover children has been eliminated.
+	else if (num_tracks > 1) {
+		// one population per voice, each on its own thread, scored with the harmony of the adjacent voices
+		MultiTrackResult result = runMultiTrack(multiTrackOptions(options, seed));
+		for (int t = 0; t < num_tracks; t++)
+			cout << "track " << t << ": " << result.tracks[t] << " with fitness = "
+				<< result.track_scores[t] / (double)SCORE_SCALE << endl;
+		cout << "harmony: " << result.harmony_score / (double)SCORE_SCALE << ", total fitness = "
+			<< result.total_score / (double)SCORE_SCALE << endl;
+		arrangement = result.tracks;
+		parent1 = result.tracks[0];
+	}
+	else if (options.multi_objective) {
+		// NSGA-II: the fitness terms are separate objectives, and the population spreads along their Pareto front
+		ThreadPool pool; // worker threads for evaluating the population, sized to the machine
+		ParetoPopulation pareto;
+		pareto.crossover = options.crossover;
+		initParetoPopulation(pareto, population_size, options.melody_length, seed, &pool);
+		vector<size_t> front;
+		for (int i = 0; i < generations; i++) {
+			evolveParetoGeneration(pareto, seed, i + 1, &pool);
+			if (options.quiet)
+				continue;
+			paretoFront(pareto, front);
+			const size_t compromise = bestCompromise(pareto);
+			cout << "Generation " << i << ": " << front.size() << " on the Pareto front, best melody = "
+				<< pareto.individuals[compromise] << " with fitness = "
+				<< objectiveSum(pareto, compromise) / (double)SCORE_SCALE << '\n';
 		}
-		cout << endl; // newline
-		// Select the two best parents for the next generation
-		best_fitness = -100;
-		second_best_fitness = -100;
-
-		// iterate through all of the children in the current population and find the best pair
-		for (int j = 0; j < population_size; j++) {
-			double current_fitness = fitness(population[j]);
-			if (current_fitness > best_fitness) {
-				// Current individual has better fitness than the best so far
-				// The old best becomes the second best
-				second_best_fitness = best_fitness;
-				second_best_individual = best_individual;
-
-				best_fitness = current_fitness;
-				best_individual = population[j];
-			}
-			else if (current_fitness > second_best_fitness) {
-				// Current individual only has better fitness than the second best
-				second_best_fitness = current_fitness;
-				second_best_individual = population[j];
-			}
+		paretoFront(pareto, front);
+		set<string> listed;
+		for (size_t k = 0; k < front.size(); ++k) {
+			const Melody& melody = pareto.individuals[front[k]];
+			if (!listed.insert(toMusicString(melody)).second)
+				continue;
+			cout << "front: " << melody;
+			for (int j = 0; j < OBJECTIVES; ++j)
+				cout << " " << objectiveName(j) << " " << pareto.objectivesOf(front[k])[j] / (double)SCORE_SCALE;
+			cout << '\n';
 		}
+		const size_t compromise = bestCompromise(pareto);
+		parent1 = pareto.individuals[compromise];
+		cout << "Best melody = " << parent1 << " with fitness = "
+			<< objectiveSum(pareto, compromise) / (double)SCORE_SCALE << endl;
+	}
+	else {
+		// worker threads for evaluating the population, sized to the machine; only started here, so
+		// that the island processes above are forked from a single threaded process
+		ThreadPool pool;
+
+		// generate initial population, each individual from its own random stream (unless resumed)
+		if (population.individuals.empty()) {
+			population.selection = options.selection;
+			population.crossover = options.crossover;
+			initPopulation(population, population_size, options.melody_length, seed, &pool);
+		}
+		else
+			cout << "resumed " << options.resume << " after generation " << first_generation << endl;
 
-		// Update parents for the next generation, best fit children become the best fit parents for subsequent generation
-		parent1 = best_individual;
-		cout << "current generation child 1: " << parent1;
-		cout << " fitness score: " << fitness(parent1) << endl;
-		parent2 = second_best_individual;
-		cout << "current generation child 2: " << parent2;
-		cout << " fitness score: " << fitness(parent2) << endl;
+		// select the two parents
+		for (int i = 0; i < population_size; i++) {
+			cout << "current melody: " << population.individuals[i] << endl;
+			cout << "fitness of current melody: " << population.scores[i] / (double)SCORE_SCALE << endl;
+		}
+		// set the two best parents from the population pool
+		parent1 = population.parent1();
+		parent2 = population.parent2();
+		cout << "parent 1: " << parent1 << endl;
+		cout << "parent 1 fitness score: " << fitness_cache.fitness(parent1) << endl;
+		cout << "parent 2: " << parent2 << endl;
+		cout << "parent 2 fitness score: " << fitness_cache.fitness(parent2) << endl;
+		if (audition) {
+			// start with the best of gen 0 and move on right away
+			cout << "auditioning parent 1 from gen 0" << endl;
+			audition->offer(parent1, population.parent1_score);
+		}
+		else {
+			cout << "playing parent 1 from gen 0: " << endl;
+			std::wstring wmelpi1 = stringToWstring(toMusicString(parent1)); // call the string conversion function
+			const TCHAR* p1 = wmelpi1.c_str(); // convert string melody into const TCHAR* to be used in the CFugue functions
+			CFugue::PlayMusicStringWithOpts(p1, nPortID, nTimerRes);
+
+			cout << "playing parent 2 from gen 0: " << endl;
+			std::wstring wmelpi2 = stringToWstring(toMusicString(parent2)); // call the string conversion function
+			const TCHAR* p2 = wmelpi2.c_str(); // convert string melody into const TCHAR* to be used in the CFugue functions
+			CFugue::PlayMusicStringWithOpts(p2, nPortID, nTimerRes);
+		}
 
-		// print the best melody and its fitness score in each generation
-		cout << "Generation " << i << ": Best melody = " << parent1 << " with fitness = " << best_fitness << endl;
+		// run simulated generations, applying GA
+		for (int i = first_generation; i < generations; i++) {
+			// crossover, mutation, scoring and selection of the next parents
+			const size_t restarts = convergence.restarts().size();
+			const bool converged = runGeneration(options, seed, population, i, pool, outputs, convergence);
+
+			// Update parents for the next generation, best fit children become the best fit parents for subsequent generation
+			parent1 = population.parent1();
+			parent2 = population.parent2();
+			if (audition)
+				audition->offer(parent1, population.parent1_score); // a new best preempts the one playing
+			if (converged) {
+				cout << "\nstopped after generation " << convergence.stop().generation << ": "
+					<< convergenceReasonName(convergence.stop().reason) << ", best melody = " << parent1
+					<< " with fitness = " << population.parent1_score / (double)SCORE_SCALE << '\n';
+				break;
+			}
+			if (convergence.restarts().size() > restarts)
+				cout << "\nrestarted after generation " << i + 1 << ": "
+					<< convergenceReasonName(convergence.restarts().back().reason) << '\n';
+			if (options.quiet)
+				continue;
+			// '\n' rather than endl, so that stdout is not flushed every generation
+			cout << '\n'; // newline
+			cout << "current generation child 1: " << parent1;
+			cout << " fitness score: " << population.parent1_score / (double)SCORE_SCALE << '\n';
+			cout << "current generation child 2: " << parent2;
+			cout << " fitness score: " << population.parent2_score / (double)SCORE_SCALE << '\n';
+
+			// print the best melody and its fitness score in each generation
+			cout << "Generation " << i << ": Best melody = " << parent1 << " with fitness = " << population.parent1_score / (double)SCORE_SCALE << '\n';
+		}
+		cout.flush();
+		outputs_written = finishOutputs(options, outputs);
 	}
-	std::wstring wmelp1 = stringToWstring(parent1); // call the string conversion function
-	const TCHAR* best = wmelp1.c_str(); // convert string melody into const TCHAR* to be used in the CFugue functions
-	CFugue::PlayMusicStringWithOpts(best, nPortID, nTimerRes);
+	if (audition)
+		audition->finish(parent1); // let the final best play to the end
+	else {
+		std::wstring wmelp1 = stringToWstring(arrangement.empty() ? toMusicString(parent1)
+			: arrangementMusicString(arrangement)); // call the string conversion function
+		const TCHAR* best = wmelp1.c_str(); // convert string melody into const TCHAR* to be used in the CFugue functions
+		CFugue::PlayMusicStringWithOpts(best, nPortID, nTimerRes);
+	}
+
+	cout << "fitness cache: " << fitness_cache.hits() << " hits, " << fitness_cache.misses()
+		<< " misses (hit rate " << fitness_cache.hitRate() * 100 << "%)" << endl;
 
 	// Uncomment the below to save notes as Midi file
 	//_tprintf(_T("\nSaving to Midi file.."));
@@ -590,5 +492,5 @@ int main(int argc, char* argv[])
 	// make the program wait before closing
 	cout << "Press any key to exit the program..." << endl;
 	cin.get();
-	return 0;
+	return outputs_written ? 0 : 1;
 }
\ No newline at end of file
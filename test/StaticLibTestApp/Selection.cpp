@@ -0,0 +1,139 @@
+// Selection.cpp
+//
+// Parent selection for the genetic algorithm: truncation (top-k), tournament and rank selection.
+
+#include "Selection.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Up to this many, the selected individuals are kept in a small sorted list during one pass
+// over the scores, which beats partitioning an index array of the whole population.
+static const size_t SMALL_K = 16;
+
+/**
+* The first k individuals in the order of comes_first, itself sorted.
+**/
+template <typename Compare>
+static void selectFirstK(const std::vector<int>& scores, size_t k, std::vector<size_t>& indices, Compare comes_first) {
+	const size_t size = scores.size();
+	if (k > size)
+		k = size;
+
+	if (k <= SMALL_K) {
+		indices.clear();
+		indices.reserve(k + 1);
+		for (size_t i = 0; i < size; ++i) {
+			if (indices.size() == k && (k == 0 || !comes_first(i, indices.back())))
+				continue;
+			// insertion into the sorted list, dropping the one that falls off the end
+			indices.insert(std::upper_bound(indices.begin(), indices.end(), i, comes_first), i);
+			if (indices.size() > k)
+				indices.pop_back();
+		}
+		return;
+	}
+
+	indices.resize(size);
+	for (size_t i = 0; i < size; ++i)
+		indices[i] = i;
+	if (k < size)
+		std::nth_element(indices.begin(), indices.begin() + k, indices.end(), comes_first);
+	std::sort(indices.begin(), indices.begin() + k, comes_first);
+	indices.resize(k);
+}
+
+void selectTopK(const std::vector<int>& scores, size_t k, std::vector<size_t>& indices) {
+	selectFirstK(scores, k, indices, [&scores](size_t a, size_t b) {
+		return scores[a] > scores[b] || (scores[a] == scores[b] && a < b);
+	});
+}
+
+void selectBottomK(const std::vector<int>& scores, size_t k, std::vector<size_t>& indices) {
+	selectFirstK(scores, k, indices, [&scores](size_t a, size_t b) {
+		return scores[a] < scores[b] || (scores[a] == scores[b] && a > b);
+	});
+}
+
+size_t tournamentSelect(const std::vector<int>& scores, unsigned int tournament_size, RandomStream& rng) {
+	const unsigned int size = (unsigned int)scores.size();
+	size_t best = rng.below(size);
+	for (unsigned int t = 1; t < tournament_size; ++t) {
+		size_t contender = rng.below(size);
+		if (scores[contender] > scores[best] || (scores[contender] == scores[best] && contender < best))
+			best = contender;
+	}
+	return best;
+}
+
+void RankSelection::rank(const std::vector<int>& scores) {
+	const size_t size = scores.size();
+	ascending.resize(size);
+	if (size == 0)
+		return;
+
+	int min = scores[0], max = scores[0];
+	for (size_t i = 1; i < size; ++i) {
+		min = std::min(min, scores[i]);
+		max = std::max(max, scores[i]);
+	}
+
+	// Scores are integer tenths in a narrow range, so a counting sort ranks the population in
+	// linear time. Fall back to a comparison sort for unusually spread out scores.
+	const size_t range = (size_t)((long long)max - min) + 1;
+	if (range > 2 * size + 4096) {
+		for (size_t i = 0; i < size; ++i)
+			ascending[i] = i;
+		std::sort(ascending.begin(), ascending.end(), [&scores](size_t a, size_t b) {
+			return scores[a] < scores[b] || (scores[a] == scores[b] && a < b);
+		});
+		return;
+	}
+
+	counts.assign(range + 1, 0);
+	for (size_t i = 0; i < size; ++i)
+		counts[scores[i] - min + 1]++;
+	for (size_t bucket = 1; bucket <= range; ++bucket)
+		counts[bucket] += counts[bucket - 1];
+	for (size_t i = 0; i < size; ++i)
+		ascending[counts[scores[i] - min]++] = i;
+}
+
+size_t RankSelection::select(RandomStream& rng) const {
+	// position i (0 = worst) has weight i + 1; invert the cumulative weight i * (i + 1) / 2
+	const double size = (double)ascending.size();
+	double x = rng.uniform() * size * (size + 1) / 2;
+	size_t position = (size_t)((std::sqrt(8 * x + 1) - 1) / 2);
+	if (position >= ascending.size())
+		position = ascending.size() - 1;
+	return ascending[position];
+}
+
+void ParentSelection::prepare(const SelectionOptions& options, const std::vector<int>& scores) {
+	this->options = options;
+	this->scores = &scores;
+	switch (options.method) {
+	case SELECTION_RANK:
+		ranking.rank(scores);
+		break;
+	case SELECTION_TRUNCATION:
+		selectTopK(scores, std::max((size_t)2, (size_t)(options.truncation * scores.size())), top);
+		break;
+	case SELECTION_BEST_TWO:
+		selectTopK(scores, 2, top);
+		break;
+	default:
+		break;
+	}
+}
+
+size_t ParentSelection::select(RandomStream& rng) const {
+	switch (options.method) {
+	case SELECTION_TOURNAMENT:
+		return tournamentSelect(*scores, options.tournament_size, rng);
+	case SELECTION_RANK:
+		return ranking.select(rng);
+	default:
+		return top[rng.below((unsigned int)top.size())];
+	}
+}
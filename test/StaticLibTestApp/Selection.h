@@ -0,0 +1,83 @@
+// Selection.h
+//
+// Parent selection for the genetic algorithm: truncation (top-k), tournament and rank selection.
+//
+// Everything works on the score list of a population and hands back indices into it, so no
+// melody is copied to select it. Top-k uses partial selection (nth_element), and rank selection
+// ranks the population with a counting sort over the integer scores, so both stay linear in the
+// population size and scale to millions of individuals.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Random.h"
+
+enum SelectionMethod {
+	SELECTION_BEST_TWO,			// every child comes from the best two individuals
+	SELECTION_TOURNAMENT,		// each parent is the best of a few random individuals
+	SELECTION_RANK,				// each parent is drawn with a probability proportional to its rank
+	SELECTION_TRUNCATION		// each parent is drawn uniformly from the best fraction of the population
+};
+
+struct SelectionOptions {
+	SelectionMethod method;
+	unsigned int tournament_size;
+	double truncation;			// fraction of the population kept by truncation selection
+
+	SelectionOptions() : method(SELECTION_BEST_TWO), tournament_size(3), truncation(0.2) {}
+};
+
+/**
+* The k best individuals, best first. Equal scores go to the lower index first.
+* Only the k selected are sorted: a small k is collected in one pass over the scores, a large
+* one by partitioning the population in linear time.
+**/
+void selectTopK(const std::vector<int>& scores, size_t k, std::vector<size_t>& indices);
+
+/**
+* The k worst individuals, worst first. Equal scores go to the higher index first.
+**/
+void selectBottomK(const std::vector<int>& scores, size_t k, std::vector<size_t>& indices);
+
+/**
+* Index of the best of tournament_size individuals drawn at random (with replacement).
+**/
+size_t tournamentSelect(const std::vector<int>& scores, unsigned int tournament_size, RandomStream& rng);
+
+/**
+* Linear ranking selection. rank() orders the population once per generation, then select()
+* draws individuals with a probability proportional to their rank (the worst has rank 1).
+* select() does not change the object, so threads can draw from it concurrently.
+**/
+class RankSelection {
+public:
+	void rank(const std::vector<int>& scores);
+	size_t select(RandomStream& rng) const;
+
+private:
+	std::vector<size_t> ascending;		// individuals from worst to best
+	std::vector<size_t> counts;			// counting sort buckets, kept to reuse their storage
+};
+
+/**
+* Parent selection of a whole generation, prepared once per generation with prepare()
+* and then drawn from by every population slot with select().
+**/
+class ParentSelection {
+public:
+	ParentSelection() : scores(NULL) {}
+
+	/**
+	* Gets ready to select from the scores, which must stay alive and unchanged while selecting.
+	* SELECTION_BEST_TWO draws each parent uniformly from the best two.
+	**/
+	void prepare(const SelectionOptions& options, const std::vector<int>& scores);
+	size_t select(RandomStream& rng) const;
+
+private:
+	SelectionOptions options;
+	const std::vector<int>* scores;
+	RankSelection ranking;
+	std::vector<size_t> top;			// the individuals kept by truncation selection
+};
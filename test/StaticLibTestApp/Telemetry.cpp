@@ -0,0 +1,129 @@
+// Telemetry.cpp
+//
+// Per-generation telemetry of a GA run, written as JSON lines or CSV.
+
+#include "Telemetry.h"
+#include "Fitness.h"
+
+#include <chrono>
+#include <cmath>
+#include <unordered_set>
+
+// Records that wake the writer thread early; otherwise it writes a few times a second
+static const size_t TELEMETRY_BATCH = 256;
+static const size_t TELEMETRY_BUFFER = 1 << 20;
+
+void describePopulation(const std::vector<Melody>& individuals, const std::vector<int>& scores,
+	GenerationRecord& record) {
+	if (scores.empty())
+		return;
+
+	int min = scores[0], max = scores[0];
+	double sum = 0;
+	for (size_t i = 0; i < scores.size(); ++i) {
+		if (scores[i] < min)
+			min = scores[i];
+		if (scores[i] > max)
+			max = scores[i];
+		sum += scores[i];
+	}
+	double mean = sum / scores.size();
+	double variance = 0;
+	for (size_t i = 0; i < scores.size(); ++i)
+		variance += (scores[i] - mean) * (scores[i] - mean);
+	variance /= scores.size();
+
+	record.min_fitness = min / (double)SCORE_SCALE;
+	record.max_fitness = max / (double)SCORE_SCALE;
+	record.mean_fitness = mean / SCORE_SCALE;
+	record.stddev_fitness = std::sqrt(variance) / SCORE_SCALE;
+
+	std::unordered_set<unsigned long long> distinct;
+	distinct.reserve(individuals.size());
+	for (size_t i = 0; i < individuals.size(); ++i)
+		distinct.insert(melodyHash(individuals[i]));
+	record.diversity = individuals.empty() ? 0 : distinct.size() / (double)individuals.size();
+}
+
+Telemetry::Telemetry() : file(NULL), format(TELEMETRY_JSONL), closing(false) {}
+
+Telemetry::~Telemetry() {
+	close();
+}
+
+bool Telemetry::open(const std::string& path) {
+	bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+	return open(path, csv ? TELEMETRY_CSV : TELEMETRY_JSONL);
+}
+
+bool Telemetry::open(const std::string& path, TelemetryFormat format) {
+	close();
+	file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+	setvbuf(file, NULL, _IOFBF, TELEMETRY_BUFFER);
+	this->format = format;
+	if (format == TELEMETRY_CSV)
+		fprintf(file, "generation,breed_ms,evaluate_ms,select_ms,min_fitness,mean_fitness,max_fitness,"
+			"stddev_fitness,diversity,cache_hit_rate\n");
+	closing = false;
+	writer = std::thread(&Telemetry::writerLoop, this);
+	return true;
+}
+
+void Telemetry::record(const GenerationRecord& record) {
+	bool wake_writer;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.push_back(record);
+		wake_writer = pending.size() == TELEMETRY_BATCH;
+	}
+	if (wake_writer)
+		wake.notify_one();
+}
+
+void Telemetry::close() {
+	if (!file)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closing = true;
+	}
+	wake.notify_one();
+	writer.join();
+	fclose(file);
+	file = NULL;
+}
+
+void Telemetry::writerLoop() {
+	std::vector<GenerationRecord> batch;
+	for (;;) {
+		bool done;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait_for(lock, std::chrono::milliseconds(250),
+				[this] { return closing || pending.size() >= TELEMETRY_BATCH; });
+			batch.swap(pending);
+			done = closing;
+		}
+		for (size_t i = 0; i < batch.size(); ++i)
+			write(batch[i]);
+		batch.clear();
+		if (done)
+			break;
+		fflush(file);
+	}
+}
+
+void Telemetry::write(const GenerationRecord& r) {
+	if (format == TELEMETRY_CSV)
+		fprintf(file, "%llu,%.4f,%.4f,%.4f,%.1f,%.4f,%.1f,%.4f,%.4f,%.4f\n", r.generation, r.breed_ms,
+			r.evaluate_ms, r.select_ms, r.min_fitness, r.mean_fitness, r.max_fitness, r.stddev_fitness,
+			r.diversity, r.cache_hit_rate);
+	else
+		fprintf(file, "{\"generation\":%llu,\"breed_ms\":%.4f,\"evaluate_ms\":%.4f,\"select_ms\":%.4f,"
+			"\"min_fitness\":%.1f,\"mean_fitness\":%.4f,\"max_fitness\":%.1f,\"stddev_fitness\":%.4f,"
+			"\"diversity\":%.4f,\"cache_hit_rate\":%.4f}\n", r.generation, r.breed_ms, r.evaluate_ms,
+			r.select_ms, r.min_fitness, r.mean_fitness, r.max_fitness, r.stddev_fitness, r.diversity,
+			r.cache_hit_rate);
+}
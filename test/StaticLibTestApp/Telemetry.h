@@ -0,0 +1,82 @@
+// Telemetry.h
+//
+// Per-generation telemetry of a GA run, written as JSON lines or CSV.
+//
+// Records are handed to a background thread that formats and writes them in batches through a
+// large file buffer, so the generation loop never waits on the disk. Telemetry is off unless a
+// Telemetry is passed to evolveGeneration(); without one no timing or statistics are collected.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Melody.h"
+
+enum TelemetryFormat { TELEMETRY_JSONL, TELEMETRY_CSV };
+
+/**
+* What is recorded about one generation. Fitness values are in points, times in milliseconds.
+**/
+struct GenerationRecord {
+	unsigned long long generation;
+	double breed_ms;			// crossover and mutation, with the delta scoring of the children
+	double evaluate_ms;			// scoring the children (with the batch kernel), picking the better one
+	double select_ms;			// replacement and parent selection
+	double min_fitness;
+	double mean_fitness;
+	double max_fitness;
+	double stddev_fitness;
+	double diversity;			// fraction of distinct melodies in the population
+	double cache_hit_rate;		// fitness cache hit rate during this generation (0 when scored by delta)
+
+	GenerationRecord() : generation(0), breed_ms(0), evaluate_ms(0), select_ms(0), min_fitness(0),
+		mean_fitness(0), max_fitness(0), stddev_fitness(0), diversity(0), cache_hit_rate(0) {}
+};
+
+/**
+* Fills in the fitness statistics and the diversity of a population.
+**/
+void describePopulation(const std::vector<Melody>& individuals, const std::vector<int>& scores,
+	GenerationRecord& record);
+
+class Telemetry {
+public:
+	Telemetry();
+	~Telemetry();
+
+	/**
+	* Starts writing to path. The format follows the extension: .csv for CSV, JSON lines otherwise.
+	* Returns false if the file cannot be created.
+	**/
+	bool open(const std::string& path);
+	bool open(const std::string& path, TelemetryFormat format);
+
+	/**
+	* Queues a record for the writer thread.
+	**/
+	void record(const GenerationRecord& record);
+
+	/**
+	* Writes the queued records and closes the file.
+	**/
+	void close();
+
+private:
+	Telemetry(const Telemetry&);				// not copyable
+	Telemetry& operator=(const Telemetry&);
+
+	void writerLoop();
+	void write(const GenerationRecord& record);
+
+	FILE* file;
+	TelemetryFormat format;
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<GenerationRecord> pending;		// guarded by mutex
+	bool closing;								// guarded by mutex
+};
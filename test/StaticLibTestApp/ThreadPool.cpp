@@ -0,0 +1,94 @@
+// ThreadPool.cpp
+//
+// Persistent pool of worker threads used to spread GA work over all cores.
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int thread_count)
+	: job_id(0), busy_workers(0), stopping(false), job_task(NULL), job_count(0), job_chunk(1), next_chunk(0) {
+	if (thread_count == 0)
+		thread_count = std::thread::hardware_concurrency();
+	if (thread_count == 0)
+		thread_count = 1;
+
+	// the calling thread is the last member of the pool
+	for (unsigned int i = 1; i < thread_count; ++i)
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(state_mutex);
+		stopping = true;
+	}
+	job_ready.notify_all();
+	for (size_t i = 0; i < workers.size(); ++i)
+		workers[i].join();
+}
+
+void ThreadPool::runChunks() {
+	for (;;) {
+		size_t begin = next_chunk.fetch_add(job_chunk);
+		if (begin >= job_count)
+			break;
+		size_t end = begin + job_chunk < job_count ? begin + job_chunk : job_count;
+		(*job_task)(begin, end);
+	}
+}
+
+void ThreadPool::workerLoop() {
+	unsigned long long seen_job = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(state_mutex);
+			while (!stopping && job_id == seen_job)
+				job_ready.wait(lock);
+			if (stopping)
+				return;
+			seen_job = job_id;
+		}
+
+		runChunks();
+
+		{
+			std::lock_guard<std::mutex> lock(state_mutex);
+			if (--busy_workers == 0)
+				job_done.notify_one();
+		}
+	}
+}
+
+void ThreadPool::parallelFor(size_t count, size_t chunk_size, const std::function<void(size_t, size_t)>& task) {
+	if (count == 0)
+		return;
+	if (chunk_size == 0) {
+		chunk_size = count / (size() * 4);
+		if (chunk_size == 0)
+			chunk_size = 1;
+	}
+
+	// Not worth waking the workers for a single chunk
+	if (workers.empty() || count <= chunk_size) {
+		task(0, count);
+		return;
+	}
+
+	std::lock_guard<std::mutex> job_lock(job_mutex);
+	{
+		std::lock_guard<std::mutex> lock(state_mutex);
+		job_task = &task;
+		job_count = count;
+		job_chunk = chunk_size;
+		next_chunk.store(0);
+		busy_workers = (unsigned int)workers.size();
+		++job_id;
+	}
+	job_ready.notify_all();
+
+	runChunks();
+
+	std::unique_lock<std::mutex> lock(state_mutex);
+	while (busy_workers != 0)
+		job_done.wait(lock);
+	job_task = NULL;
+}
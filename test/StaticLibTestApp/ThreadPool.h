@@ -0,0 +1,69 @@
+// ThreadPool.h
+//
+// Persistent pool of worker threads used to spread GA work (fitness evaluation etc.)
+// over all cores. The workers are created once and reused for every parallelFor() call,
+// so no threads are started or joined inside the generation loop.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+	/**
+	* Starts the workers. A thread_count of 0 sizes the pool to the machine
+	* (one thread per hardware thread, the calling thread included).
+	**/
+	explicit ThreadPool(unsigned int thread_count = 0);
+	~ThreadPool();
+
+	/**
+	* Number of threads that run tasks, the calling thread included.
+	**/
+	unsigned int size() const { return (unsigned int)workers.size() + 1; }
+
+	/**
+	* Calls task(begin, end) for consecutive chunks covering [0, count) and returns once
+	* every chunk is done. The calling thread works on chunks too. A chunk_size of 0 picks
+	* a size that gives each thread a few chunks to balance the load.
+	* Results are deterministic as long as the task only writes to the entries of its chunk.
+	**/
+	void parallelFor(size_t count, size_t chunk_size, const std::function<void(size_t, size_t)>& task);
+
+	/**
+	* Same for any callable (e.g. a lambda). The task is wrapped by reference, so unlike
+	* converting a capturing lambda to std::function this never allocates.
+	**/
+	template <typename Task>
+	void parallelFor(size_t count, size_t chunk_size, const Task& task) {
+		parallelFor(count, chunk_size, std::function<void(size_t, size_t)>(std::cref(task)));
+	}
+
+private:
+	ThreadPool(const ThreadPool&);				// not copyable
+	ThreadPool& operator=(const ThreadPool&);
+
+	void workerLoop();
+	void runChunks();
+
+	std::vector<std::thread> workers;
+
+	std::mutex job_mutex;						// serializes parallelFor() calls
+	std::mutex state_mutex;
+	std::condition_variable job_ready;
+	std::condition_variable job_done;
+	unsigned long long job_id;					// incremented for every job
+	unsigned int busy_workers;					// workers still inside the current job
+	bool stopping;
+
+	// the current job
+	const std::function<void(size_t, size_t)>* job_task;
+	size_t job_count;
+	size_t job_chunk;
+	std::atomic<size_t> next_chunk;
+};